@@ -0,0 +1,94 @@
+#include "../include/log.hpp"
+#include "../include/lexer.hpp"
+#include "../include/scanner.hpp"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+// Lexer throughput of every scan kernel set the CPU supports, in MB/s.
+// Lexes the given .zeph file, or a generated script of about 5 MB with deep
+// indentation, comments, long identifiers and strings
+//
+//   lexbench [file.zeph]
+
+static constexpr int RUNS = 5;
+
+static std::string generateScript(const std::string& path) {
+  std::ofstream out(path, std::ios::binary);
+  if (!out) {
+    Log::err("Cannot write ", path);
+  }
+
+  for (int i = 0; i < 12000; i++) {
+    out << "# iteration " << i << " of the generated benchmark, comments are skipped whole\n";
+    out << "def some_rather_long_function_name_" << i << "(first_parameter, second_parameter) {\n";
+    out << "        let accumulated_value_for_this_step = first_parameter * 1234567 + 3.14159;\n";
+    out << "        if (accumulated_value_for_this_step >= second_parameter) {\n";
+    out << "                print(\"a string literal long enough to be worth scanning in wide steps\");\n";
+    out << "        }\n";
+    out << "        return accumulated_value_for_this_step;\n";
+    out << "}\n\n";
+  }
+
+  return path;
+}
+
+struct Scan {
+  size_t tokens = 0;
+  int lastLine = 0;
+};
+
+static Scan lexFile(std::string& path, const ScanKernels& kernels) {
+  Lexer lexer(kernels);
+  lexer.open(path);
+
+  Scan scan;
+  Token token = lexer.next();
+  while (token.type != TokenType::END_OF_FILE) {
+    scan.tokens++;
+    token = lexer.next();
+  }
+  scan.lastLine = token.line;
+  return scan;
+}
+
+int main(int argc, char* argv[]) {
+  std::string path;
+  bool generated = argc < 2;
+  if (generated) {
+    path = generateScript((std::filesystem::temp_directory_path() / "zeph_lexbench.zeph").string());
+  } else {
+    path = argv[1];
+  }
+
+  double megabytes = std::filesystem::file_size(path) / (1024.0 * 1024.0);
+  Log::log("lexing ", path, " (", megabytes, " MB), best of ", RUNS, " runs");
+
+  Scan reference;
+  for (const ScanKernels* kernels : supportedScanKernels()) {
+    double best = 1e300;
+    Scan scan;
+    for (int run = 0; run < RUNS; run++) {
+      auto start = std::chrono::steady_clock::now();
+      scan = lexFile(path, *kernels);
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      best = std::min(best, elapsed.count());
+    }
+
+    // Every kernel set must see the same token stream
+    if (reference.tokens == 0) {
+      reference = scan;
+    } else if (scan.tokens != reference.tokens || scan.lastLine != reference.lastLine) {
+      Log::err(kernels->name, " kernels produced ", scan.tokens, " tokens up to line ", scan.lastLine,
+               ", expected ", reference.tokens, " up to line ", reference.lastLine);
+    }
+
+    Log::log(kernels->name, ": ", megabytes / best, " MB/s (", scan.tokens, " tokens)");
+  }
+
+  if (generated) {
+    std::filesystem::remove(path);
+  }
+}
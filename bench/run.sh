@@ -0,0 +1,102 @@
+#!/usr/bin/env bash
+# Runs the benchmark scripts next to this file and prints the best CPU time
+# of each, with the work it did per second.
+#
+#   bench/run.sh [-n runs] posea [baseline-posea] [script.zeph...]
+#
+# Each script says what it measures in its header:
+#   # work: <count> <unit>        units of work one run does
+#   # configs: <flags> | <flags>  engine flags to run it with, empty for the
+#                                 tree walker
+# Given a baseline (a posea built from an older commit), every config also
+# runs on it and the speedup is printed. Configs the baseline does not know
+# are skipped. The output of every run must match the first config's
+
+set -u
+
+runs=5
+if [ "${1:-}" = "-n" ]; then
+  runs=$2
+  shift 2
+fi
+
+if [ $# -lt 1 ]; then
+  echo "usage: $0 [-n runs] posea [baseline-posea] [script.zeph...]" >&2
+  exit 1
+fi
+
+posea=$1
+shift
+baseline=""
+if [ $# -gt 0 ] && [ "${1%.zeph}" = "$1" ]; then
+  baseline=$1
+  shift
+fi
+
+dir=$(cd "$(dirname "$0")" && pwd)
+if [ $# -gt 0 ]; then
+  scripts=("$@")
+else
+  scripts=("$dir"/*.zeph)
+fi
+
+# Best user + sys time of a run, in seconds. Prints nothing when it fails
+best_time() {
+  local binary=$1 flags=$2 script=$3 best="" t
+  for ((i = 0; i < runs; i++)); do
+    TIMEFORMAT='%3U %3S'
+    t=$( { time "$binary" $flags "$script" > /dev/null 2>&1 || echo fail >&2; } 2>&1 )
+    case $t in *fail*) return ;; esac
+    t=$(echo "$t" | awk '{ print $1 + $2 }')
+    if [ -z "$best" ] || awk -v a="$t" -v b="$best" 'BEGIN { exit !(a < b) }'; then
+      best=$t
+    fi
+  done
+  echo "$best"
+}
+
+status=0
+for script in "${scripts[@]}"; do
+  name=$(basename "$script")
+  work=$(sed -n 's/^# work: *//p' "$script" | head -1)
+  count=${work%% *}
+  unit=${work#* }
+  configs=$(sed -n 's/^# configs: *//p' "$script" | head -1)
+
+  echo "$name"
+  expected=""
+  IFS='|' read -ra list <<< "${configs:- }"
+  for flags in "${list[@]}"; do
+    flags=$(echo $flags)
+    label=${flags:-tree walker}
+
+    output=$("$posea" $flags "$script" 2>&1)
+    if [ -z "$expected" ]; then
+      expected=$output
+    elif [ "$output" != "$expected" ]; then
+      echo "  $label: output differs from the first config" >&2
+      status=1
+    fi
+
+    t=$(best_time "$posea" "$flags" "$script")
+    if [ -z "$t" ]; then
+      echo "  $label: failed" >&2
+      status=1
+      continue
+    fi
+    line=$(awk -v t="$t" -v n="$count" -v u="$unit" -v l="$label" \
+      'BEGIN { printf "  %-12s %7.3fs %12.0f %s/s", l, t, (t > 0 ? n / t : 0), u }')
+
+    if [ -n "$baseline" ]; then
+      b=$(best_time "$baseline" "$flags" "$script")
+      if [ -n "$b" ]; then
+        line+=$(awk -v t="$t" -v b="$b" 'BEGIN { printf "   baseline %7.3fs  %5.2fx", b, (t > 0 ? b / t : 0) }')
+      else
+        line+="   baseline n/a"
+      fi
+    fi
+    echo "$line"
+  done
+done
+
+exit $status
@@ -0,0 +1,89 @@
+#pragma once
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Fixed-size array of arena allocated items, used for the child lists of AST nodes
+template <typename T>
+struct NodeList {
+  T* items = nullptr;
+  size_t count = 0;
+
+  T* begin() const { return items; }
+  T* end() const { return items + count; }
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  T& operator[](size_t i) const { return items[i]; }
+};
+
+// Bump allocator that owns everything allocated for one parse. Destructors of
+// the objects placed in it are never run, so they must not own resources of
+// their own (AST nodes only hold pointers, string_views and NodeLists). The
+// whole arena is released at once when it is destroyed
+class Arena {
+  public:
+  static const size_t BLOCK_SIZE = 64 * 1024;
+
+  Arena() {};
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  ~Arena() {
+    for (char* block : blocks) {
+      std::free(block);
+    }
+  }
+
+  void* allocate(size_t size, size_t align) {
+    size_t offset = (used + align - 1) & ~(align - 1);
+
+    if (current == nullptr || offset + size > capacity) {
+      // Oversized requests get a block of their own
+      capacity = size + align > BLOCK_SIZE ? size + align : BLOCK_SIZE;
+      current = static_cast<char*>(std::malloc(capacity));
+      if (current == nullptr) {
+        throw std::bad_alloc();
+      }
+
+      blocks.push_back(current);
+      offset = (reinterpret_cast<size_t>(current) + align - 1) & ~(align - 1);
+      offset -= reinterpret_cast<size_t>(current);
+    }
+
+    used = offset + size;
+    return current + offset;
+  }
+
+  template <typename T, typename... Args>
+  T* make(Args&&... args) {
+    return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+  }
+
+  // Copies items [from, end) of a scratch vector into the arena and truncates
+  // the vector back to 'from', so nested lists can share one scratch vector
+  template <typename T>
+  NodeList<T> takeList(std::vector<T>& scratch, size_t from) {
+    NodeList<T> list;
+    list.count = scratch.size() - from;
+
+    if (list.count > 0) {
+      list.items = static_cast<T*>(allocate(sizeof(T) * list.count, alignof(T)));
+      for (size_t i = 0; i < list.count; i++) {
+        new (&list.items[i]) T(scratch[from + i]);
+      }
+    }
+
+    scratch.resize(from);
+    return list;
+  }
+
+  size_t blockCount() const { return blocks.size(); }
+
+  private:
+  std::vector<char*> blocks;
+  char* current = nullptr;
+  size_t used = 0;
+  size_t capacity = 0;
+};
@@ -1,5 +1,7 @@
 #pragma once
 #include "enviroment.hpp"
+#include "heap.hpp"
 
 void declarePrintFunction(Enviroment& env);
-void declareTypeofFunction(Enviroment& env);
\ No newline at end of file
+void declareTypeofFunction(Enviroment& env);
+void declareGcStepFunction(Enviroment& env);
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "node.hpp"
+#include "values.hpp"
+
+// Every instruction is one opcode byte followed by its u16 operands
+//   name, operand count, stack effect
+#define BYTECODE_OPCODES(X)                                                    \
+  X(CONSTANT, 1, 1)       /* constant index */                                 \
+  X(PUSH_NULL, 0, 1)                                                           \
+  X(PUSH_TRUE, 0, 1)                                                           \
+  X(PUSH_FALSE, 0, 1)                                                          \
+  X(POP, 0, -1)                                                                \
+  X(GET_LOCAL, 2, 1)      /* slot, name */                                     \
+  X(GET_VAR, 3, 1)        /* depth, slot, name */                              \
+  X(SET_LOCAL, 2, 0)      /* slot, name; leaves the value on the stack */      \
+  X(SET_VAR, 3, 0)        /* depth, slot, name */                              \
+  X(UNDEFINED_VAR, 1, 1)  /* name; raises "does not exist" */                  \
+  X(DECLARE_VAR, 2, -1)   /* slot, name */                                     \
+  X(MAKE_FUNCTION, 1, 0)  /* chunk index; declares it in its slot */           \
+  X(ADD, 0, -1)                                                                \
+  X(SUB, 0, -1)                                                                \
+  X(MUL, 0, -1)                                                                \
+  X(DIV, 0, -1)                                                                \
+  X(MOD, 0, -1)                                                                \
+  X(EQ, 0, -1)                                                                 \
+  X(LT, 0, -1)                                                                 \
+  X(LE, 0, -1)                                                                 \
+  X(GT, 0, -1)                                                                 \
+  X(GE, 0, -1)                                                                 \
+  X(AND, 1, -1)           /* forward offset; jumps keeping false */            \
+  X(OR, 1, -1)            /* forward offset; jumps keeping true */             \
+  X(TEST, 0, 0)           /* turns the top into its logical truth */           \
+  X(JUMP, 1, 0)           /* forward offset */                                 \
+  X(JUMP_IF_FALSE, 1, -1) /* forward offset */                                 \
+  X(LOOP_IF_TRUE, 1, -1)  /* backward offset */                                \
+  X(CALL, 2, 0)           /* argument count, callee name; pops argc values */ \
+  X(RETURN, 0, -1)
+
+enum class OpCode : uint8_t {
+#define BYTECODE_ENUM(name, operands, effect) name,
+  BYTECODE_OPCODES(BYTECODE_ENUM)
+#undef BYTECODE_ENUM
+};
+
+const char* opCodeName(OpCode op);
+int opCodeOperands(OpCode op);
+
+// Compiled body of one function (or of the top level)
+struct Chunk {
+  std::vector<uint8_t> code;
+  std::vector<Value> constants;
+  std::vector<std::string_view> names; // variable names, kept for error messages
+  FunctionDeclaration* decl = nullptr; // nullptr for the top level
+  int maxStack = 0;                    // deepest operand stack the code needs
+};
+
+// Output of the Compiler. Chunks reference the Program's AST and source, so the
+// Program has to outlive the Module
+struct Module {
+  std::vector<std::unique_ptr<Chunk>> chunks; // chunks[0] is the top level
+};
+
+void disassemble(const Module& module);
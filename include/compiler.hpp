@@ -0,0 +1,57 @@
+#pragma once
+#include "node.hpp"
+#include "bytecode.hpp"
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// Lowers a resolved Program to bytecode for the VM. Runs after the Resolver,
+// variables are compiled to the (depth, slot) pairs it assigned.
+//
+// Control flow follows the tree-walking interpreter: a break or continue
+// outside a loop leaves the outermost enclosing if statement, and a return at
+// the top level leaves the current top level statement.
+class Compiler {
+  public:
+  Compiler();
+
+  std::unique_ptr<Module> compile(Program& program);
+
+  private:
+  struct Loop {
+    std::vector<size_t> breaks;
+    std::vector<size_t> continues;
+  };
+
+  // Per chunk state, saved while a nested function is compiled
+  struct FunctionState {
+    Chunk* chunk = nullptr;
+    std::vector<Loop> loops;
+    std::vector<size_t>* ifEscapes = nullptr;        // break / continue outside a loop
+    std::vector<size_t>* statementEscapes = nullptr; // top level return
+    std::unordered_map<uint64_t, uint16_t> constantIndex; // keyed by the value's bits
+    std::unordered_map<std::string_view, uint16_t> nameIndex;
+    int stackDepth = 0;
+  };
+
+  Module* module = nullptr;
+  FunctionState* state = nullptr;
+
+  void compileStatement(Statement* stmt);
+  void compileBody(NodeList<Statement*>& body);
+  void compileExpression(Statement* node);
+  void compileIf(IfStatement* ifStmt);
+  void compileWhile(WhileStatement* whileStmt);
+  void compileReturn(ReturnStatement* ret);
+  void compileEscape(bool isBreak);
+  uint16_t compileFunction(FunctionDeclaration* decl);
+  void compileVariable(OpCode local, OpCode outer, int depth, int slot, std::string_view name);
+
+  void emit(OpCode op);
+  void emitOperand(size_t operand);
+  size_t emitJump(OpCode op);
+  void patchJump(size_t operandAt);
+  void emitLoop(size_t target);
+  uint16_t addConstant(Value value);
+  uint16_t addName(std::string_view name);
+};
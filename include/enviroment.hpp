@@ -1,24 +1,76 @@
 #pragma once
 #include <unordered_map>
 #include <string>
+#include <span>
+#include <string_view>
 #include <vector>
 #include "values.hpp"
+#include "pool.hpp"
 #include "log.hpp"
 
-struct RuntimeValue;
-
+// A scope frame. Variables live in slots assigned by the Resolver, a slot is
+// Value::empty() until its declaration runs. Only the global enviroment keeps a
+// name -> slot table, for the host and the resolver, keyed by interned strings.
+// Constness is checked by the Resolver before the program runs, the global
+// enviroment only records which of the host's bindings are constant
 class Enviroment {
   public:
   Enviroment* parent;
-  std::unordered_map<std::string, RuntimeValue*> variables;
-  std::vector<std::string> constants;
+  std::span<Value> slots; // in storage, or in the value stack of an engine
+  std::unordered_map<const StringValue*, int> names;
+  // Bumped whenever a slot gains or loses a function, call site caches
+  // check it instead of reading the slot
+  uint64_t bindingVersion = 0;
+
+  // Links in the Heap's list of live frames, which are the collector's roots
+  Enviroment* prevLive = nullptr;
+  Enviroment* nextLive = nullptr;
 
   Enviroment();
-  Enviroment(Enviroment* parentEnv);
-
-  RuntimeValue* declareVariable(std::string& varname, RuntimeValue* value, bool constant);
-  RuntimeValue* assignVariable(std::string& varname, RuntimeValue* value);
-  RuntimeValue* declareVariable(const char* varname, RuntimeValue* value, bool constant);
-  RuntimeValue* assignVariable(const char* varname, RuntimeValue* value);
-  Enviroment& resolve(std::string& varname);
-};
\ No newline at end of file
+  Enviroment(Enviroment* parentEnv, int slotCount);
+  // A frame over slots the caller owns and keeps rooted, the Heap does not
+  // scan it
+  Enviroment(Enviroment* parentEnv, std::span<Value> slots);
+  ~Enviroment();
+  Enviroment(const Enviroment&) = delete;
+  Enviroment& operator=(const Enviroment&) = delete;
+
+  static void* operator new(size_t size) { return Pool::allocate(size); }
+  static void operator delete(void* pointer, size_t size) { Pool::free(pointer, size); }
+
+  // Turns a used frame into a fresh one, lets the VM reuse frames across calls
+  void reset(Enviroment* parentEnv, int slotCount);
+
+  // The enviroment depth scopes up, depth must not be negative
+  Enviroment* ancestor(int depth) {
+    Enviroment* env = this;
+    for (int i = 0; i < depth; i++) {
+      env = env->parent;
+    }
+    return env;
+  }
+
+  // Slot access, used by the interpreter
+  Value declareVariable(int slot, std::string_view varname, Value value);
+  Value assignVariable(int depth, int slot, std::string_view varname, Value value);
+  // Inline, every variable read of the interpreter goes through it
+  Value lookupVariable(int depth, int slot, std::string_view varname) {
+    Value value = depth < 0 ? Value::empty() : ancestor(depth)->slots[slot];
+    if (value.isEmpty()) {
+      undefinedVariable(varname);
+    }
+    return value;
+  }
+
+  // Name access, used by the host before a program runs
+  Value declareVariable(std::string_view varname, Value value, bool constant);
+  int slotOf(std::string_view varname);
+  int defineSlot(std::string_view varname);
+  bool isConstant(int slot) const;
+
+  private:
+  std::vector<Value, PoolAllocator<Value>> storage;
+  static void undefinedVariable(std::string_view varname);
+  std::vector<bool> constantSlots; // host declarations only
+  bool registered = true;
+};
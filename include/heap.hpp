@@ -0,0 +1,173 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "values.hpp"
+
+class Enviroment;
+
+// Owns every RuntimeValue created while a program runs and frees the
+// unreachable ones with a tri-color mark-sweep collection.
+//
+// Roots are every live Enviroment frame (they register themselves), values
+// pushed on the temporary root stack by code that holds them across an
+// allocation, and the root markers of the engines (the VM value stack).
+//
+// By default a whole collection runs inside make() once the bytes allocated
+// since the last one pass a threshold that grows with the live size. In
+// incremental mode the host drives the collector with gcStep() instead, each
+// call doing at most a time budget of marking or sweeping. While marking,
+// every store of a value into an enviroment or a heap object must go through
+// writeBarrier() so the mutator never hides a white object behind a black one.
+class Heap {
+  public:
+  // Upper bounds of the pause histogram buckets, the last one is open
+  static constexpr std::array<int64_t, 9> PAUSE_BUCKETS_US = {50, 100, 250, 500, 1000, 2000, 4000, 8000, 16000};
+
+  struct Stats {
+    size_t bytesLive = 0;
+    size_t bytesAllocated = 0; // over the whole run
+    size_t objectsLive = 0;
+    size_t collections = 0;    // completed cycles
+    size_t pauses = 0;         // full collections and incremental steps
+    std::chrono::nanoseconds totalPause{0};
+    std::chrono::nanoseconds maxPause{0};
+    std::array<size_t, PAUSE_BUCKETS_US.size() + 1> pauseHistogram{};
+  };
+
+  enum Phase {
+    IDLE,
+    MARK,
+    SWEEP,
+  };
+
+  static constexpr size_t MIN_THRESHOLD = 1024 * 1024;
+  static constexpr size_t GROWTH_FACTOR = 2;
+  // In incremental mode a full collection still runs when the host lets the
+  // allocations run this far past the threshold without stepping
+  static constexpr size_t HARD_LIMIT_FACTOR = 4;
+
+  static Heap& get() { return instance; }
+
+  Heap();
+  ~Heap();
+  Heap(const Heap&) = delete;
+  Heap& operator=(const Heap&) = delete;
+
+  template <typename T, typename... Args>
+  T* make(Args&&... args) {
+    if (bytesSinceCollection >= threshold) {
+      collectIfDue();
+    }
+
+    T* object = new T(std::forward<Args>(args)...);
+    track(object);
+    return object;
+  }
+
+  // Runs a complete collection, finishing the current cycle if one is running
+  void collect();
+
+  // Does up to budgetMicros of collection work. Starts a cycle when the
+  // allocation threshold was reached, does nothing otherwise
+  void gcStep(int64_t budgetMicros);
+
+  void setIncremental(bool incremental) { this->incremental = incremental; }
+  bool isIncremental() const { return incremental; }
+  Phase phase() const { return currentPhase; }
+
+  inline void writeBarrier(Value value) {
+    if (currentPhase == MARK && value.isObject()) {
+      markObject(value.asObject());
+    }
+  }
+
+  // Returns the shared string with these characters, made on first use.
+  // Interned strings live as long as the Heap and are never collected
+  StringValue* intern(std::string_view chars);
+
+  // For objects that take more memory after they were made
+  void grow(size_t bytes);
+
+  // Temporary roots, for values held in C++ locals across an allocation
+  void pushRoot(Value value);
+  void popRoots(size_t count);
+
+  int addRootMarker(std::function<void(Heap&)> marker);
+  void removeRootMarker(int id);
+
+  void addEnviroment(Enviroment* env);
+  void removeEnviroment(Enviroment* env);
+
+  void markValue(Value value);
+  void markObject(RuntimeValue* object);
+
+  const Stats& stats() const { return statistics; }
+  void printStats() const;
+
+  private:
+  using Clock = std::chrono::steady_clock;
+
+  static Heap instance;
+
+  RuntimeValue* objects = nullptr;    // every allocated object, newest first
+  RuntimeValue* sweepList = nullptr;  // objects still to be swept this cycle
+  Enviroment* enviroments = nullptr;  // live frames, newest first
+  std::vector<Value> tempRoots;
+  std::vector<std::pair<int, std::function<void(Heap&)>>> rootMarkers;
+  int nextMarkerId = 0;
+  std::vector<RuntimeValue*> grayStack;
+  std::unordered_map<std::string_view, StringValue*> internTable; // keys point into the strings
+
+  bool incremental = false;
+  Phase currentPhase = IDLE;
+  size_t bytesSinceCollection = 0;
+  size_t threshold = MIN_THRESHOLD;
+  Stats statistics;
+
+  void collectIfDue();
+  void track(RuntimeValue* object);
+  void beginCycle();
+  void markRoots();
+  bool work(Clock::time_point deadline, bool bounded);
+  bool traceSome(Clock::time_point deadline, bool bounded);
+  bool sweepSome(Clock::time_point deadline, bool bounded);
+  void finishMarking();
+  void finishCycle();
+  void recordPause(Clock::duration pause);
+  static size_t sizeOf(RuntimeValue* object);
+  static void destroy(RuntimeValue* object);
+};
+
+// Keeps the temporary roots pushed in a scope alive until it ends. Costs
+// nothing when only inline values pass through it
+class RootScope {
+  public:
+  RootScope(Heap& heap) : heap(heap) {}
+  ~RootScope() {
+    if (count > 0) {
+      heap.popRoots(count);
+    }
+  }
+  RootScope(const RootScope&) = delete;
+  RootScope& operator=(const RootScope&) = delete;
+
+  // Inline values need no rooting, only heap objects are pushed
+  Value root(Value value) {
+    if (value.isObject()) {
+      heap.pushRoot(value);
+      count++;
+    }
+    return value;
+  }
+
+  private:
+  Heap& heap;
+  size_t count = 0;
+};
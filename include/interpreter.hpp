@@ -2,25 +2,59 @@
 #include "values.hpp"
 #include "enviroment.hpp"
 #include "node.hpp"
+#include "operations.hpp"
+#include "heap.hpp"
 #include "log.hpp"
+#include <memory>
 #include <string>
+#include <string_view>
 
+// How the last statement finished. return, break and continue set it instead
+// of producing a value, the statements that handle them check and clear it
+enum Completion {
+  NORMAL_COMPLETION,
+  RETURN_COMPLETION,
+  BREAK_COMPLETION,
+  CONTINUE_COMPLETION,
+};
+
+// Call frames live in one contiguous value stack. A call writes its arguments
+// straight into the callee's slots and gives the frame back when it returns
 class Interpreter {
 public:
+  static constexpr size_t STACK_SIZE = 1 << 18; // values
+
+  Heap& heap = Heap::get();
+  Completion completion = NORMAL_COMPLETION;
+  Value returnValue = Value::null(); // set by a return, read by the call
+
   Interpreter();
+  ~Interpreter();
+  Interpreter(const Interpreter&) = delete;
+  Interpreter& operator=(const Interpreter&) = delete;
 
-  RuntimeValue* evaluate(Statement* stmt, Enviroment& env);
-  RuntimeValue* evaluateBinaryExpression(BinaryExpression* binExpr, Enviroment& env);
-  RuntimeValue* evaluateProgram(Program* program, Enviroment& env);
-  RuntimeValue* evaluateIdentifier(Identifier* ident, Enviroment& env);
-  RuntimeValue* evaluateVariableDeclaration(VarDeclaration* decl, Enviroment& env);
-  RuntimeValue* evaluateFunctionDeclaration(FunctionDeclaration* decl, Enviroment& env);
-  RuntimeValue* evaluateCallExpression(CallExpression* expr, Enviroment& env);
-  RuntimeValue* evaluateComparisonExpression(ComparisonExpression* comp, Enviroment& env);
-  RuntimeValue* evaluateLogicalExpression(LogicalExpression* logic, Enviroment& env);
-  RuntimeValue* evaluateVariableAssignment(VariableAssignment* assign, Enviroment& env);
-  RuntimeValue* evaluateIfStatement(IfStatement* ifStmt, Enviroment& env);
-  RuntimeValue* evaluateWhileStatement(WhileStatement* whileStmt, Enviroment& env);
+  Value evaluate(Statement* stmt, Enviroment& env);
+  Value evaluateBinaryExpression(BinaryExpression* binExpr, Enviroment& env);
+  Value evaluateProgram(Program* program, Enviroment& env);
+  Value evaluateIdentifier(Identifier* ident, Enviroment& env);
+  Value evaluateVariableDeclaration(VarDeclaration* decl, Enviroment& env);
+  Value evaluateFunctionDeclaration(FunctionDeclaration* decl, Enviroment& env);
+  Value evaluateCallExpression(CallExpression* expr, Enviroment& env);
+  Value evaluateComparisonExpression(ComparisonExpression* comp, Enviroment& env);
+  Value evaluateLogicalExpression(LogicalExpression* logic, Enviroment& env);
+  Value evaluateVariableAssignment(VariableAssignment* assign, Enviroment& env);
+  Value evaluateIfStatement(IfStatement* ifStmt, Enviroment& env);
+  Value evaluateWhileStatement(WhileStatement* whileStmt, Enviroment& env);
   bool calculateComparizon(ComparisonExpression* comp, Enviroment& env);
-  float calculateNumericBinaryExpression(float leftValue, float rightValue, const std::string& op);
+  FunctionValue* lookupCallee(CallExpression* expr, Enviroment& env);
+  Value evaluateOperand(Expression* expr, Enviroment& env);
+  bool calculateLogical(LogicalExpression* logic, Enviroment& env);
+  bool testOperand(Expression* expr, Enviroment& env);
+  // Only the first test of a while condition accepts null
+  bool testCondition(Expression* cond, Enviroment& env, bool acceptNull);
+
+private:
+  std::unique_ptr<Value[]> stack;
+  Value* stackTop;
+  int rootMarker;
 };
\ No newline at end of file
@@ -0,0 +1,80 @@
+#pragma once
+#include "values.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#if defined(__x86_64__) && defined(__linux__)
+#define JIT_SUPPORTED
+#endif
+
+struct JitCode;
+
+// Optional baseline JIT for small integer functions, x86-64 Linux only and
+// off unless --jit is given.
+//
+// Both engines hand every call of a user function to tryCall(). Calls made
+// with integer arguments are counted on the FunctionValue, and once a
+// function reaches HOT_THRESHOLD of them its body is translated node by node
+// into machine code, placed in mmap'd executable memory by a small assembler
+// of our own.
+//
+// Only functions with no side effects are compiled: they may use their
+// parameters and locals, int literals, + - * / %, comparisons, and / or, if,
+// while, return and calls to themselves. Anything else (globals, strings,
+// doubles, host functions) leaves the function to the engine. That makes
+// every guard cheap to fall back from: when one fails in the middle of a
+// call (an int overflow, an inexact division, a division by zero, deep
+// recursion, frames nearing the end of the native stack) the machine code is
+// abandoned and the engine runs the whole call again, then keeps the function
+// for good.
+//
+// Self calls jump straight into the machine code, so a call only enters it
+// while the function's global name still holds the function. The code belongs
+// to its FunctionValue, the Heap counts it with the function and frees it when
+// the function is collected.
+class Jit {
+  public:
+  static constexpr uint32_t HOT_THRESHOLD = 100;
+  static constexpr int64_t MAX_DEPTH = 10000; // deeper recursion is left to the engines
+  static constexpr size_t MAX_PARAMS = 6;     // passed in registers
+
+  static Jit& get() { return instance; }
+
+  Jit();
+  ~Jit();
+  Jit(const Jit&) = delete;
+  Jit& operator=(const Jit&) = delete;
+
+  static constexpr bool isSupported() {
+#ifdef JIT_SUPPORTED
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  void setEnabled(bool enabled) { this->enabled = enabled && isSupported(); }
+  bool isEnabled() const { return enabled; }
+
+  // Size and release of the machine code of a function, code may be null
+  static size_t codeSize(const JitCode* code);
+  static void release(JitCode* code);
+
+  // Runs the call as machine code when the function is compiled, or just got
+  // hot, and the guards hold. Returns false when the engine must run it
+  bool tryCall(FunctionValue* function, std::span<const Value> args, Value& result) {
+    if (!enabled || function->jitRejected) {
+      return false;
+    }
+    return call(function, args, result);
+  }
+
+  private:
+  static Jit instance;
+
+  bool enabled = false;
+
+  bool call(FunctionValue* function, std::span<const Value> args, Value& result);
+  JitCode* compile(FunctionValue* function);
+};
@@ -0,0 +1,98 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include "token.hpp"
+
+struct Keyword {
+  std::string_view lexeme;
+  TokenType type;
+};
+
+// Adding a keyword only takes a new entry here, the hash below is searched
+// again at compile time and the build fails if no collision free one exists
+inline constexpr Keyword KEYWORDS[] = {
+  {"let", TokenType::LET},
+  {"const", TokenType::CONST},
+  {"def", TokenType::DEF},
+  {"return", TokenType::RETURN},
+  {"null", TokenType::NULL_TOKEN},
+  {"true", TokenType::BOOLEAN_TOKEN},
+  {"false", TokenType::BOOLEAN_TOKEN},
+  {"if", TokenType::IF},
+  {"else", TokenType::ELSE},
+  {"while", TokenType::WHILE},
+  {"break", TokenType::BREAK},
+  {"continue", TokenType::CONTINUE},
+  {"and", TokenType::AND},
+  {"or", TokenType::OR},
+};
+
+inline constexpr size_t KEYWORD_COUNT = sizeof(KEYWORDS) / sizeof(KEYWORDS[0]);
+inline constexpr size_t KEYWORD_TABLE_SIZE = 64;
+
+constexpr size_t keywordHash(std::string_view s, uint32_t seed) {
+  uint32_t h = (uint32_t)s.size() * seed;
+  h ^= (unsigned char)s[0] * 0x9E3779B1u;
+  h += (unsigned char)s[s.size() - 1] * seed;
+  return (h >> 7) % KEYWORD_TABLE_SIZE;
+}
+
+constexpr uint32_t findKeywordSeed() {
+  for (uint32_t seed = 1; seed < 100000; seed++) {
+    bool used[KEYWORD_TABLE_SIZE] = {};
+    bool collides = false;
+    for (const Keyword& keyword : KEYWORDS) {
+      size_t slot = keywordHash(keyword.lexeme, seed);
+      if (used[slot]) {
+        collides = true;
+        break;
+      }
+      used[slot] = true;
+    }
+    if (!collides) return seed;
+  }
+  return 0;
+}
+
+inline constexpr uint32_t KEYWORD_SEED = findKeywordSeed();
+static_assert(KEYWORD_SEED != 0, "No perfect hash found for the keyword table, increase KEYWORD_TABLE_SIZE");
+
+// Slot -> index into KEYWORDS plus one (zero marks an empty slot)
+constexpr std::array<uint8_t, KEYWORD_TABLE_SIZE> buildKeywordTable() {
+  std::array<uint8_t, KEYWORD_TABLE_SIZE> table = {};
+  for (size_t i = 0; i < KEYWORD_COUNT; i++) {
+    table[keywordHash(KEYWORDS[i].lexeme, KEYWORD_SEED)] = (uint8_t)(i + 1);
+  }
+  return table;
+}
+
+constexpr size_t keywordLength(bool longest) {
+  size_t n = KEYWORDS[0].lexeme.size();
+  for (const Keyword& keyword : KEYWORDS) {
+    size_t size = keyword.lexeme.size();
+    n = (longest ? size > n : size < n) ? size : n;
+  }
+  return n;
+}
+
+inline constexpr std::array<uint8_t, KEYWORD_TABLE_SIZE> KEYWORD_TABLE = buildKeywordTable();
+inline constexpr size_t KEYWORD_MIN_LENGTH = keywordLength(false);
+inline constexpr size_t KEYWORD_MAX_LENGTH = keywordLength(true);
+
+// Returns the keyword token type for an identifier lexeme, or IDENTIFIER
+constexpr TokenType keywordType(std::string_view ident) {
+  if (ident.size() < KEYWORD_MIN_LENGTH || ident.size() > KEYWORD_MAX_LENGTH) {
+    return TokenType::IDENTIFIER;
+  }
+
+  uint8_t entry = KEYWORD_TABLE[keywordHash(ident, KEYWORD_SEED)];
+  if (entry != 0 && KEYWORDS[entry - 1].lexeme == ident) {
+    return KEYWORDS[entry - 1].type;
+  }
+
+  return TokenType::IDENTIFIER;
+}
+
+static_assert(keywordType("while") == TokenType::WHILE);
+static_assert(keywordType("whilst") == TokenType::IDENTIFIER);
@@ -1,12 +1,22 @@
 #pragma once
-#include <vector>
 #include <string>
+#include <memory>
 #include "token.hpp"
+#include "source.hpp"
+#include "scanner.hpp"
 
 class Lexer {
   public:
-  std::vector<Token> tokens;
+  std::shared_ptr<SourceFile> source;
   
   Lexer();
-  std::vector<Token> tokenize(std::string filepath);
-};
\ No newline at end of file
+  explicit Lexer(const ScanKernels& kernels);
+  void open(std::string& filepath);
+  Token next();
+
+  private:
+  const ScanKernels* scan;
+  const char* cursor = nullptr;
+  const char* end = nullptr;
+  int line = 1;
+};
@@ -29,11 +29,7 @@ public:
 
     switch (node->type) {
       case NodeType::PROGRAM: {
-        auto program = dynamic_cast<const Program*>(node);
-        if (!program) {
-          err("Invalid PROGRAM node cast.");
-          return;
-        }
+        auto program = nodeCast<const Program>(node);
         printIndent();
         log("Program: {");
         for (const auto& stmt : program->body) {
@@ -45,11 +41,7 @@ public:
       }
 
       case NodeType::VAR_DECLARATION: {
-        auto declaration = dynamic_cast<const VarDeclaration*>(node);
-        if (!declaration) {
-          err("Invalid VAR_DECLARATION node cast.");
-          return;
-        }
+        auto declaration = nodeCast<const VarDeclaration>(node);
         printIndent();
         log("VarDeclaration: ", declaration->symbol, " {");
         printIndent(1); log("symbol: {", declaration->symbol, "}");
@@ -61,11 +53,7 @@ public:
       }
 
       case NodeType::FUNC_DECLARATION: {
-        auto declaration = dynamic_cast<const FunctionDeclaration*>(node);
-        if (!declaration) {
-          err("Invalid FUNC_DECLARATION node cast.");
-          return;
-        }
+        auto declaration = nodeCast<const FunctionDeclaration>(node);
         printIndent();
         log("FuncDeclaration: ", declaration->name, " {");
 
@@ -87,68 +75,44 @@ public:
       }
 
       case NodeType::IDENTIFIER_LITERAL: {
-        auto ident = dynamic_cast<const Identifier*>(node);
-        if (!ident) {
-          err("Invalid IDENTIFIER_LITERAL node cast.");
-          return;
-        }
+        auto ident = nodeCast<const Identifier>(node);
         printIndent();
         log("Identifier: {", ident->symbol, "}");
         break;
       }
 
       case NodeType::NUMERIC_LITERAL: {
-        auto num = dynamic_cast<const NumericLiteral*>(node);
-        if (!num) {
-          err("Invalid NUMERIC_LITERAL node cast.");
-          return;
-        }
+        auto num = nodeCast<const NumericLiteral>(node);
         printIndent();
-        log("NumericLiteral: {", num->value, "}");
+        log("NumericLiteral: {", num->negative ? "-" : "", num->value, "}");
         break;
       }
 
       case NodeType::STRING_LITERAL: {
-        auto str = dynamic_cast<const StringLiteral*>(node);
-        if (!str) {
-          err("Invalid STRING_LITERAL node cast.");
-          return;
-        }
+        auto str = nodeCast<const StringLiteral>(node);
         printIndent();
         log("StringLiteral: {\"", str->value, "\"}");
         break;
       }
 
       case NodeType::NULL_LITERAL: {
-        auto nll = dynamic_cast<const NullLiteral*>(node);
-        if (!nll) {
-          err("Invalid NULL_LITERAL node cast");
-          return;
-        }
+        auto nll = nodeCast<const NullLiteral>(node);
         printIndent();
         log("NullLiteral: {", nll->value, "}");
         break;
       }
 
       case NodeType::BOOLEAN_LITERAL: {
-        auto bll = dynamic_cast<const BooleanLiteral*>(node);
-        if (!bll) {
-          err("Invalid BOOLEAN_LITERAL node cast");
-          return;
-        }
+        auto bll = nodeCast<const BooleanLiteral>(node);
         printIndent();
         log("BooleanLiteral: {", bll->value, "}");
         break;
       }
 
       case NodeType::BINARY_EXPRESSION: {
-        auto bin = dynamic_cast<const BinaryExpression*>(node);
-        if (!bin) {
-          err("Invalid BINARY_EXPRESSION node cast.");
-          return;
-        }
+        auto bin = nodeCast<const BinaryExpression>(node);
         printIndent();
-        log("BinaryExpression: ", bin->op, " {");
+        log("BinaryExpression: ", operatorSymbol(bin->op), " {");
         printAST(bin->left, indent + 1);
         printAST(bin->right, indent + 1);
         printIndent();
@@ -157,11 +121,7 @@ public:
       }
 
       case NodeType::VAR_ASSIGNMENT: {
-        auto assign = dynamic_cast<const VariableAssignment*>(node);
-        if (!assign) {
-          err("Invalid VariableAssignment node cast.");
-          return;
-        }
+        auto assign = nodeCast<const VariableAssignment>(node);
         printIndent();
         log("VaribleAssignment: ", assign->ident, " {");
         printAST(assign->expr, indent + 1);
@@ -171,13 +131,9 @@ public:
       }
 
       case NodeType::COMPARISON_EXPRESSION: {
-        auto comp = dynamic_cast<const ComparisonExpression*>(node);
-        if (!comp) {
-          err("Invalid ComparisonExpression node cast.");
-          return;
-        }
+        auto comp = nodeCast<const ComparisonExpression>(node);
         printIndent();
-        log("ComparisonExpression: == {");
+        log("ComparisonExpression: ", operatorSymbol(comp->op), " {");
         printAST(comp->lhs, indent + 1);
         printAST(comp->rhs, indent + 1);
         printIndent();
@@ -186,13 +142,9 @@ public:
       }
 
       case NodeType::LOGICAL_EXPRESSION: {
-        auto logic = dynamic_cast<const LogicalExpression*>(node);
-        if (!logic) {
-          err("Invalid LogicalExpression node cast.");
-          return;
-        }
+        auto logic = nodeCast<const LogicalExpression>(node);
         printIndent();
-        log("Logical Expression: ", logic->op, " {");
+        log("Logical Expression: ", operatorSymbol(logic->op), " {");
         printAST(logic->lhs, indent + 1);
         printAST(logic->rhs, indent + 1);
         printIndent();
@@ -200,6 +152,75 @@ public:
         break;
       }
 
+      case NodeType::CALL_EXPRESSION: {
+        auto call = nodeCast<const CallExpression>(node);
+        printIndent();
+        log("CallExpression: {");
+        printAST(call->caller, indent + 1);
+        printIndent(1); log("arguments: {");
+        for (const auto& arg : call->arguments) {
+          printAST(arg, indent + 2);
+        }
+        printIndent(1); log("}");
+        printIndent(); log("}");
+        break;
+      }
+
+      case NodeType::RETURN_STATEMENT: {
+        auto ret = nodeCast<const ReturnStatement>(node);
+        printIndent();
+        log("ReturnStatement: {");
+        printAST(ret->value, indent + 1);
+        printIndent();
+        log("}");
+        break;
+      }
+
+      case NodeType::IF_STATEMENT: {
+        auto ifStmt = nodeCast<const IfStatement>(node);
+        printIndent();
+        log("IfStatement: {");
+        printAST(ifStmt->cond, indent + 1);
+        printIndent(1); log("body: {");
+        for (const auto& stmt : ifStmt->ifBody) {
+          printAST(stmt, indent + 2);
+        }
+        printIndent(1); log("}");
+        if (!ifStmt->elseBody.empty()) {
+          printIndent(1); log("else: {");
+          for (const auto& stmt : ifStmt->elseBody) {
+            printAST(stmt, indent + 2);
+          }
+          printIndent(1); log("}");
+        }
+        printIndent(); log("}");
+        break;
+      }
+
+      case NodeType::WHILE_STATEMENT: {
+        auto whileStmt = nodeCast<const WhileStatement>(node);
+        printIndent();
+        log("WhileStatement: {");
+        printAST(whileStmt->cond, indent + 1);
+        printIndent(1); log("body: {");
+        for (const auto& stmt : whileStmt->body) {
+          printAST(stmt, indent + 2);
+        }
+        printIndent(1); log("}");
+        printIndent(); log("}");
+        break;
+      }
+
+      case NodeType::BREAK_STATEMENT:
+        printIndent();
+        log("BreakStatement");
+        break;
+
+      case NodeType::CONTINUE_STATEMENT:
+        printIndent();
+        log("ContinueStatement");
+        break;
+
       default:
         printIndent();
         log("Unknown Node Type");
@@ -212,70 +233,19 @@ public:
     printAST(&program);
   }
 
-  static void printValue(RuntimeValue* program) {
-    if (program->type == ValueType::NUMBER_VALUE) {
-      auto cast = static_cast<NumberValue*>(program);
-      if (!cast) {
-        Log::err("Error casting");
-      }
-      log("Result: {", cast->value, "}");
-    } else if (program->type == ValueType::STRING_VALUE) {
-      auto cast = static_cast<StringValue*>(program);
-      if (!cast) {
-        Log::err("Error casting");
-      }
-      log("Result: {\"", cast->value, "\"}");
-    } else if (program->type == ValueType::NULL_VALUE) {
-      auto cast = static_cast<NullValue*>(program);
-      if (!cast) {
-        Log::err("Error casting");
-      }
-      log("Result: {", cast->value, "}");
-    } else if (program->type == ValueType::BOOLEAN_VALUE) {
-      auto cast = static_cast<BooleanValue*>(program);
-      if (!cast) {
-        Log::err("Error casting");
-      }
-      log("Result: {", cast->value, "}");
-    } else if (program->type == ValueType::FUNCTION_VALUE) {
-      auto cast = static_cast<FunctionValue*>(program);
-      if (!cast) {
-        Log::err("Error casting");
-      }
-      log("Result: {function: ", cast->name, "}");
-    } else if (program->type == ValueType::RETURN_VALUE) {
-      auto cast = static_cast<ReturnValue*>(program);
-      if (!cast) {
-        Log::err("Error casting");
-      }
-      
-      if (cast->value->type == ValueType::NUMBER_VALUE) {
-        auto result = static_cast<NumberValue*>(cast->value);
-        if (!result) {
-          Log::err("Error casting");
-        }
-        log("Result: {", result->value, "}");
-      } else if (cast->value->type == ValueType::BOOLEAN_VALUE) {
-        auto result = static_cast<BooleanValue*>(cast->value);
-        if (!result) {
-          Log::err("Error casting");
-        }
-        log("Result: {", result->value, "}");
-      } else if (cast->value->type == ValueType::STRING_VALUE) {
-        auto result = static_cast<StringValue*>(cast->value);
-        if (!result) {
-          Log::err("Error casting");
-        }
-        log("Result: {\"", result->value, "\"}");
-      } else if (cast->value->type == ValueType::NULL_VALUE) {
-        auto result = static_cast<NullValue*>(cast->value);
-        if (!result) {
-          Log::err("Error casting");
-        }
-        log("Result: {", result->value, "}");
-      }
+  static void printValue(Value value) {
+    if (value.type() == ValueType::NUMBER_VALUE) {
+      log("Result: {", value.asNumber(), "}");
+    } else if (value.type() == ValueType::STRING_VALUE) {
+      log("Result: {\"", static_cast<StringValue*>(value.asObject())->flat(), "\"}");
+    } else if (value.type() == ValueType::NULL_VALUE) {
+      log("Result: {null}");
+    } else if (value.type() == ValueType::BOOLEAN_VALUE) {
+      log("Result: {", value.asBool(), "}");
+    } else if (value.type() == ValueType::FUNCTION_VALUE) {
+      log("Result: {function: ", static_cast<FunctionValue*>(value.asObject())->name, "}");
     } else {
-      log("Unrecognized type in program result: ", program->type);
+      log("Unrecognized type in program result: ", value.type());
     }
   }
 };
@@ -1,7 +1,13 @@
 #pragma once
+#include <cassert>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <memory>
 #include <vector>
 #include "node.hpp"
+#include "source.hpp"
+#include "arena.hpp"
 
 // ALL NODE TYPES
 enum NodeType {
@@ -26,9 +32,58 @@ enum NodeType {
   STRING_LITERAL,
   BOOLEAN_LITERAL,
   IDENTIFIER_LITERAL,
+  // Quickened Expressions, binary and comparison nodes the interpreter has
+  // specialized for the operand types it saw (see interpreter.cpp)
+  ADD_INT_INT,
+  SUB_INT_INT,
+  MUL_INT_INT,
+  MOD_INT_INT,
+  ADD_NUM_NUM,
+  SUB_NUM_NUM,
+  MUL_NUM_NUM,
+  DIV_NUM_NUM,
+  CONCAT_STR_STR,
+  EQ_NUM_NUM,
+  LT_NUM_NUM,
+  LE_NUM_NUM,
+  GT_NUM_NUM,
+  GE_NUM_NUM,
 };
 
 
+// OPERATORS
+enum BinaryOperator : uint8_t {
+  OP_ADD,
+  OP_SUB,
+  OP_MUL,
+  OP_DIV,
+  OP_MOD,
+};
+
+enum ComparisonOperator : uint8_t {
+  OP_EQ,
+  OP_LT,
+  OP_LE,
+  OP_GT,
+  OP_GE,
+};
+
+enum LogicalOperator : uint8_t {
+  OP_AND,
+  OP_OR,
+};
+
+const char* operatorSymbol(BinaryOperator op);
+const char* operatorSymbol(ComparisonOperator op);
+const char* operatorSymbol(LogicalOperator op);
+
+struct StringValue;
+struct FunctionValue;
+class Enviroment;
+
+// Nodes are placed in the Program's arena and never destroyed one by one, so
+// their members must not own memory (see arena.hpp)
+
 // Statements do not result in values at runtime
 struct Statement {
   public:
@@ -43,55 +98,70 @@ struct Expression : Statement {
   Expression(NodeType t) : Statement(t) {}
 };
 
+// Downcast for a node whose NodeType has already been checked. The cast is a
+// plain static_cast, RTTI only double checks it in debug builds
+template <typename T, typename Node>
+inline T* nodeCast(Node* node) {
+  assert(dynamic_cast<T*>(node) != nullptr && "NodeType does not match node class");
+  return static_cast<T*>(node);
+}
+
 // STATEMENTS //
 struct Program : Statement {
   public:
-  std::vector<Statement*> body;
+  NodeList<Statement*> body;
+  std::shared_ptr<SourceFile> source; // keeps the bytes referenced by the AST alive
+  std::unique_ptr<Arena> arena;       // owns every node of the tree
   
-  Program(std::vector<Statement*> body) : Statement(NodeType::PROGRAM), body(body) {}
+  Program() : Statement(NodeType::PROGRAM) {}
 };
 
 struct VarDeclaration : Statement {
   public:
-  std::string symbol;
+  std::string_view symbol;
   Expression* value;
   bool isConstant;
+  int slot = -1; // set by the Resolver
 
-  VarDeclaration(std::string symbol, Expression* value, bool isConstant) : Statement(NodeType::VAR_DECLARATION), symbol(symbol), value(value), isConstant(isConstant) {}
+  VarDeclaration(std::string_view symbol, Expression* value, bool isConstant) : Statement(NodeType::VAR_DECLARATION), symbol(symbol), value(value), isConstant(isConstant) {}
 };
 
 struct WhileStatement : Statement {
   public:
   Expression* cond = nullptr;
-  std::vector<Statement*> body;
+  NodeList<Statement*> body;
 
-  WhileStatement(Expression* cond, std::vector<Statement*> body) : Statement(NodeType::WHILE_STATEMENT), cond(cond), body(body) {};
+  WhileStatement(Expression* cond, NodeList<Statement*> body) : Statement(NodeType::WHILE_STATEMENT), cond(cond), body(body) {};
 };
 
 struct IfStatement : Statement {
   public:
   Expression* cond = nullptr;
-  std::vector<Statement*> ifBody;
-  std::vector<Statement*> elseBody;
+  NodeList<Statement*> ifBody;
+  NodeList<Statement*> elseBody;
 
-  IfStatement(Expression* cond, std::vector<Statement*> ifBody, std::vector<Statement*> elseBody) : Statement(NodeType::IF_STATEMENT), cond(cond), ifBody(ifBody), elseBody(elseBody) {};
+  IfStatement(Expression* cond, NodeList<Statement*> ifBody, NodeList<Statement*> elseBody) : Statement(NodeType::IF_STATEMENT), cond(cond), ifBody(ifBody), elseBody(elseBody) {};
 };
 
 struct FunctionDeclaration : Statement {
   public:
-  std::string name;
-  std::vector<std::string> params;
-  std::vector<Statement*> body;
+  std::string_view name;
+  NodeList<std::string_view> params;
+  NodeList<Statement*> body;
+  int slot = -1;       // slot of the function name in the declaring scope
+  int localCount = 0;  // frame size: parameters first, then locals
 
-  FunctionDeclaration(std::string name, std::vector<std::string> params, std::vector<Statement*> body) : Statement(NodeType::FUNC_DECLARATION), name(name), params(params), body(body) {}
+  FunctionDeclaration(std::string_view name, NodeList<std::string_view> params, NodeList<Statement*> body) : Statement(NodeType::FUNC_DECLARATION), name(name), params(params), body(body) {}
 };
 
 struct VariableAssignment : Statement {
   public:
-  std::string ident;
+  std::string_view ident;
   Expression* expr = nullptr;
+  int depth = -1; // scopes to walk up, -1 when the name was not found
+  int slot = -1;
 
- VariableAssignment(std::string ident, Expression* expr) : Statement(NodeType::VAR_ASSIGNMENT), ident(ident), expr(expr) {};
+ VariableAssignment(std::string_view ident, Expression* expr) : Statement(NodeType::VAR_ASSIGNMENT), ident(ident), expr(expr) {};
 };
 
 struct ReturnStatement : Statement {
@@ -116,54 +186,69 @@ struct ContinueStatement : Statement {
 // EXPRESSIONS //
 struct Identifier : Expression {
   public:
-  std::string symbol;
+  std::string_view symbol;
+  int depth = -1; // scopes to walk up, -1 when the name was not found
+  int slot = -1;
+  bool global = false; // bound in the global enviroment
   
-  Identifier(std::string symbol) : Expression(NodeType::IDENTIFIER_LITERAL), symbol(symbol) {};
+  Identifier(std::string_view symbol) : Expression(NodeType::IDENTIFIER_LITERAL), symbol(symbol) {};
 };
 
 struct NullLiteral : Expression {
   public:
-  std::string value = "null";
+  std::string_view value = "null";
 
   NullLiteral() : Expression(NodeType::NULL_LITERAL) {};
 };
 
 struct BooleanLiteral : Expression {
   public:
-  std::string value;
+  std::string_view value;
 
-  BooleanLiteral(std::string value) : Expression(NodeType::BOOLEAN_LITERAL), value(value) {};
+  BooleanLiteral(std::string_view value) : Expression(NodeType::BOOLEAN_LITERAL), value(value) {};
 };
 
 struct NumericLiteral : Expression {
   public:
-  std::string value;
+  std::string_view value;
+  bool negative;
+  double number;
+  bool integer; // number fits an int32 and was written without a decimal point
   
-  NumericLiteral(std::string value) : Expression(NodeType::NUMERIC_LITERAL), value(value) {};
+  NumericLiteral(std::string_view value, bool negative, double number, bool integer) : Expression(NodeType::NUMERIC_LITERAL), value(value), negative(negative), number(number), integer(integer) {};
 };
 
 struct StringLiteral : Expression {
   public:
-  std::string value;
+  std::string_view value;
+  StringValue* interned = nullptr; // shared runtime string, made on first evaluation
   
-  StringLiteral(std::string value) : Expression(NodeType::STRING_LITERAL), value(value) {};
+  StringLiteral(std::string_view value) : Expression(NodeType::STRING_LITERAL), value(value) {};
 };
 
 struct BinaryExpression : Expression {
   public:
-  std::string op;
   Expression *left;
   Expression *right;
+  BinaryOperator op;
+  bool quickened = false; // its form was picked, a deoptimized node stays generic
 
-  BinaryExpression(std::string op, Expression *left, Expression *right) : Expression(NodeType::BINARY_EXPRESSION), left(left), right(right), op(op) {};
+  BinaryExpression(BinaryOperator op, Expression *left, Expression *right) : Expression(NodeType::BINARY_EXPRESSION), left(left), right(right), op(op) {};
 };
 
 struct CallExpression : Expression {
   public:
   Expression* caller;  // Typically an Identifier
-  std::vector<Expression*> arguments;
+  NodeList<Expression*> arguments;
+
+  // Inline cache of the interpreter. Only callees bound in the global
+  // enviroment are cached, the entry holds while its binding version does
+  FunctionValue* cachedCallee = nullptr;
+  const Enviroment* cachedScope = nullptr;
+  uint64_t cachedVersion = 0;
+  bool cachedNative = false;
 
-  CallExpression(Expression* caller, std::vector<Expression*> args)
+  CallExpression(Expression* caller, NodeList<Expression*> args)
     : Expression(NodeType::CALL_EXPRESSION), caller(caller), arguments(args) {}
 };
 
@@ -171,16 +256,17 @@ struct ComparisonExpression : Expression {
   public:
   Expression* lhs = nullptr;
   Expression* rhs = nullptr;
-  std::string op;
+  ComparisonOperator op;
+  bool quickened = false; // its form was picked, a deoptimized node stays generic
 
-  ComparisonExpression(Expression* lhs, Expression* rhs, std::string op) : Expression(NodeType::COMPARISON_EXPRESSION), lhs(lhs), rhs(rhs), op(op) {};
+  ComparisonExpression(Expression* lhs, Expression* rhs, ComparisonOperator op) : Expression(NodeType::COMPARISON_EXPRESSION), lhs(lhs), rhs(rhs), op(op) {};
 };
 
 struct LogicalExpression : Expression {
   public:
-  std::string op;
   Expression* lhs = nullptr;
   Expression* rhs = nullptr;
+  LogicalOperator op;
 
-  LogicalExpression(Expression* lhs, Expression* rhs, std::string& op) : Expression(NodeType::LOGICAL_EXPRESSION), lhs(lhs), rhs(rhs), op(op) {};
+  LogicalExpression(Expression* lhs, Expression* rhs, LogicalOperator op) : Expression(NodeType::LOGICAL_EXPRESSION), lhs(lhs), rhs(rhs), op(op) {};
 };
\ No newline at end of file
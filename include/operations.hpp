@@ -0,0 +1,45 @@
+#pragma once
+#include "values.hpp"
+#include "node.hpp"
+
+// Semantics of the operators on runtime values, shared by every engine
+double calculateNumericBinaryExpression(double left, double right, BinaryOperator op);
+Value calculateIntegerBinaryExpression(int64_t left, int64_t right, BinaryOperator op);
+Value calculateBinaryExpression(Value left, Value right, BinaryOperator op);
+// What every binary operator does with two strings
+Value concatStrings(Value left, Value right);
+bool calculateComparison(Value lhs, Value rhs, ComparisonOperator op);
+
+// Raise the type errors of the two tests below, kept out of line
+bool conditionTypeError(Value value);
+bool logicalTypeError(Value value);
+
+// Truth of an if or while condition. Null reads as false only where
+// acceptNull is set, a repeated while test rejects it
+inline bool isTruthy(Value value, bool acceptNull) {
+  if (value.isBool()) {
+    return value.asBool();
+  } else if (value.isInt()) {
+    return value.asInt() != 0;
+  } else if (value.isDouble()) {
+    return value.asDouble() != 0;
+  } else if (acceptNull && value.isNull()) {
+    return false;
+  }
+  return conditionTypeError(value);
+}
+
+// Truth of an operand of and / or, where a number only counts when it is 1
+inline bool isLogicallyTrue(Value value) {
+  if (value.isBool()) {
+    return value.asBool();
+  } else if (value.isInt()) {
+    return value.asInt() == 1;
+  } else if (value.isDouble()) {
+    return value.asDouble() == 1;
+  }
+  return logicalTypeError(value);
+}
+
+// How a number reads when printed or joined to a string
+std::string numberToString(Value number);
@@ -0,0 +1,46 @@
+#pragma once
+#include "node.hpp"
+#include "values.hpp"
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Runs after the Resolver and rewrites the tree in place so neither engine
+// redoes at runtime what is already known from the source:
+//
+// - operators whose operands are literals are folded into one literal, the
+//   same way the engines would compute them. Operations that would raise an
+//   error are left alone, so the error still comes when (and if) they run
+// - uses of a const whose initializer folds to a literal become that literal.
+//   Only declarations at the top of a function or of the program are
+//   propagated, since those always ran before anything that comes after them
+// - if and while statements with a literal condition lose the branch that can
+//   never run. A taken if body is spliced into the enclosing body unless it
+//   holds a break, continue or return (those stop the if itself)
+//
+// Folded nodes are made in the program's arena.
+class Optimizer {
+  public:
+  void optimize(Program& program);
+
+  private:
+  using Constants = std::unordered_map<int, Expression*>; // slot to literal
+
+  Arena* arena = nullptr;
+  std::vector<Constants> scopes; // innermost last, empty while in the global scope
+  Constants globalConstants;
+  std::vector<Statement*> scratch;
+
+  NodeList<Statement*> optimizeBody(NodeList<Statement*> body, bool topLevel);
+  void optimizeStatement(Statement* stmt, bool topLevel);
+  // Pushes what replaces an if statement on the scratch list
+  void pruneIf(IfStatement* ifStmt);
+  Expression* optimizeExpression(Expression* expr);
+  Expression* foldBinary(BinaryExpression* bin);
+  Expression* foldComparison(ComparisonExpression* comp);
+  Expression* foldLogical(LogicalExpression* logic);
+
+  bool literalValue(Expression* expr, Value& value);
+  Expression* makeLiteral(Value value);
+  std::string_view copyText(std::string_view text);
+};
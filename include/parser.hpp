@@ -1,5 +1,5 @@
 #pragma once
-#include "lexer.hpp"
+#include "tokenStream.hpp"
 #include "token.hpp"
 #include "node.hpp"
 #include <vector>
@@ -8,16 +8,22 @@
 
 class Parser {
   private:
-  std::vector<Token> tokens;
+  TokenStream tokens;
   bool changedLine = false;
+  Arena* arena = nullptr;
+
+  // Child lists are collected here and then copied into the arena in one piece
+  std::vector<Statement*> statementScratch;
+  std::vector<Expression*> expressionScratch;
+  std::vector<std::string_view> nameScratch;
 
   public:
   Parser();
-  Token peak();
-  Token peak(int n);
-  Token eat();
-  Token expect(TokenType tokenType, const char* errorMessage);
-  Token expect(TokenType tokenType, std::string& errorMessage);
+  const Token& peak();
+  const Token& peak(int n);
+  const Token& eat();
+  const Token& expect(TokenType tokenType, const char* errorMessage);
+  const Token& expect(TokenType tokenType, std::string& errorMessage);
   void expectOptionalSemicolon(std::string& errorMessage);
   void expectOptionalSemicolon(const char * errorMessage);
   bool isNextTokenOnSameLine();
@@ -39,4 +45,6 @@ class Parser {
   Statement* parseWhileStatement();
   Statement* parseBreakStatement();
   Statement* parseContinueStatement();
+  NodeList<Statement*> parseBlock();
+  Expression* makeNumericLiteral(Token token, bool negative);
 };
\ No newline at end of file
@@ -0,0 +1,87 @@
+#pragma once
+#include <cstddef>
+#include <new>
+
+// Size-class allocator for the small objects the engines create and free all
+// the time: heap objects and enviroment slot arrays. Every thread keeps a free
+// list per 16 byte size class, so these allocations never touch the global
+// allocator (or its locks) once the pools are warm. Empty lists are refilled
+// by cutting up a 64 KiB slab. Slabs are never given back, freed blocks only
+// go back on their list. Requests over 256 bytes go to operator new
+class Pool {
+  public:
+  static constexpr size_t GRANULARITY = 16;
+  static constexpr size_t MAX_SIZE = 256;
+  static constexpr size_t SLAB_SIZE = 64 * 1024;
+
+  static void* allocate(size_t size) {
+    if (BYPASS || size > MAX_SIZE) {
+      return ::operator new(size);
+    }
+
+    Block*& head = freeLists[classOf(size)];
+    if (head == nullptr) {
+      refill(classOf(size));
+    }
+
+    Block* block = head;
+    head = block->next;
+    return block;
+  }
+
+  // size must be the one the block was allocated with
+  static void free(void* pointer, size_t size) {
+    if (BYPASS || size > MAX_SIZE) {
+      ::operator delete(pointer);
+      return;
+    }
+
+    Block* block = static_cast<Block*>(pointer);
+    Block*& head = freeLists[classOf(size)];
+    block->next = head;
+    head = block;
+  }
+
+  private:
+  // Recycled blocks would hide use-after-free from AddressSanitizer
+#ifdef __SANITIZE_ADDRESS__
+  static constexpr bool BYPASS = true;
+#else
+  static constexpr bool BYPASS = false;
+#endif
+
+  struct Block {
+    Block* next;
+  };
+
+  static constexpr size_t CLASS_COUNT = MAX_SIZE / GRANULARITY;
+
+  static size_t classOf(size_t size) {
+    return size == 0 ? 0 : (size - 1) / GRANULARITY;
+  }
+
+  static inline thread_local Block* freeLists[CLASS_COUNT] = {};
+
+  static void refill(size_t sizeClass);
+};
+
+// Lets standard containers take their storage from the pools
+template <typename T>
+struct PoolAllocator {
+  using value_type = T;
+
+  PoolAllocator() = default;
+  template <typename U>
+  PoolAllocator(const PoolAllocator<U>&) {}
+
+  T* allocate(size_t count) {
+    return static_cast<T*>(Pool::allocate(count * sizeof(T)));
+  }
+
+  void deallocate(T* pointer, size_t count) {
+    Pool::free(pointer, count * sizeof(T));
+  }
+
+  template <typename U>
+  bool operator==(const PoolAllocator<U>&) const { return true; }
+};
@@ -0,0 +1,50 @@
+#pragma once
+#include "node.hpp"
+#include "enviroment.hpp"
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Runs after parsing and gives every variable a fixed slot in its scope's
+// frame. Uses are annotated with how many scopes up the binding lives and its
+// slot, so the interpreter never looks names up at runtime.
+//
+// Only function bodies open a new scope (if/while bodies share the enclosing
+// one). Inside a scope names are visible from their declaration on, while
+// function bodies are resolved once the enclosing scope is complete, since
+// they run after it has been set up.
+//
+// Constness belongs to the binding, so assigning to a const is reported here
+// and never checked at runtime. A name declared both const and not in one
+// scope is rejected for the same reason.
+class Resolver {
+  public:
+  Resolver(Enviroment& globals);
+
+  void resolve(Program& program);
+
+  private:
+  struct Binding {
+    int slot;
+    bool constant;
+  };
+
+  struct Scope {
+    std::unordered_map<std::string_view, Binding> bindings;
+    int count = 0;
+    std::vector<FunctionDeclaration*> pending;
+  };
+
+  Enviroment& globals;
+  std::vector<Scope> scopes; // innermost last, empty while in the global scope
+  Scope globalScope;         // globals declared by the program, slots come from globals
+  std::vector<FunctionDeclaration*> pendingGlobals;
+
+  int declare(std::string_view name, bool constant);
+  Binding lookup(std::string_view name, int& depth);
+  void resolveBody(NodeList<Statement*>& body);
+  void resolvePending();
+  void resolveFunction(FunctionDeclaration* decl);
+  void resolveStatement(Statement* stmt);
+  void resolveExpression(Expression* expr);
+};
@@ -0,0 +1,18 @@
+#pragma once
+#include <vector>
+
+// Kernels for the lexer's byte-run loops. Each one returns a pointer to the
+// first byte in [p, end) that ends the run (or end when the run reaches it)
+struct ScanKernels {
+  const char* name;
+  const char* (*skipSpaces)(const char* p, const char* end, int& line); // also counts '\n'
+  const char* (*skipIdentifier)(const char* p, const char* end);
+  const char* (*skipDigits)(const char* p, const char* end);
+  const char* (*findNewline)(const char* p, const char* end);
+  const char* (*findQuote)(const char* p, const char* end);
+};
+
+// Picks the widest kernel set the running CPU supports (AVX2, SSE2 or scalar)
+const ScanKernels& scanKernels();
+// Every kernel set the running CPU supports, scalar first. For benchmarks
+std::vector<const ScanKernels*> supportedScanKernels();
@@ -0,0 +1,23 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+// Read-only view of a source file. The file is memory mapped so tokens and
+// AST nodes can reference its bytes directly instead of copying them
+class SourceFile {
+  public:
+  std::string path;
+
+  SourceFile(std::string& filepath);
+  ~SourceFile();
+  SourceFile(const SourceFile&) = delete;
+  SourceFile& operator=(const SourceFile&) = delete;
+
+  std::string_view text() const;
+
+  private:
+  const char* data = nullptr;
+  size_t size = 0;
+  bool mapped = false;
+  std::string buffer; // only used when the file cannot be mapped
+};
@@ -1,10 +1,11 @@
 #pragma once
-#include <string>
+#include <string_view>
 
 enum TokenType {
   END_OF_FILE,
   IDENTIFIER,
   NUMBER,
+  INTEGER,
   BOOLEAN_TOKEN,
   STRING,
   EQUAL,
@@ -36,7 +37,8 @@ enum TokenType {
 struct Token {
   public:
   TokenType type;
-  std::string value;
+  std::string_view value;
   int line;
-  Token(TokenType type, std::string value, int line);
+  Token();
+  Token(TokenType type, std::string_view value, int line);
 };
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+#include "lexer.hpp"
+#include "token.hpp"
+#include <string>
+#include <memory>
+
+// Pulls tokens from the lexer on demand and keeps a fixed lookahead window,
+// so the parser never holds more than LOOKAHEAD tokens at once
+class TokenStream {
+  public:
+  static const int LOOKAHEAD = 2;
+
+  TokenStream();
+  void open(std::string& filepath);
+  const Token& peak(int n = 0);
+  const Token& advance();
+  std::shared_ptr<SourceFile> source();
+
+  private:
+  Lexer lexer;
+  Token window[LOOKAHEAD];
+  Token previous;
+  int cursor = 0;
+};
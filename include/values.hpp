@@ -1,80 +1,175 @@
 #pragma once
 #include "node.hpp"
-#include "values.hpp"
+#include "pool.hpp"
+#include <bit>
+#include <cstdint>
 #include <functional>
+#include <span>
+#include <string>
+#include <vector>
 
 enum ValueType {
   NULL_VALUE,
   NUMBER_VALUE,
   STRING_VALUE,
-  RETURN_VALUE,
   BOOLEAN_VALUE,
   FUNCTION_VALUE,
-  BREAK_VALUE,
-  CONTINUE_VALUE,
 };
 
 class Enviroment;
+struct Chunk;
+struct JitCode;
+struct RuntimeValue;
 
-struct RuntimeValue {
+// A runtime value in 64 bits (NaN-boxing). Doubles are stored as themselves,
+// every other value hides in the payload of a quiet NaN:
+//
+//   null, booleans, ints   0x7ffc | tag (bits 32-34) | int32 payload
+//   heap objects           0xfffc | 48 bit pointer
+//
+// Numbers, booleans and null never touch the heap, only strings and functions
+// are RuntimeValue objects. Numbers are int32 while they fit, arithmetic that
+// overflows an int32 carries on in doubles.
+class Value {
   public:
-  ValueType type;
+  Value() : bits(NULL_BITS) {}
 
-  RuntimeValue(ValueType type) : type(type) {} 
-};
+  static Value number(double value) {
+    if (value != value) {
+      return Value(CANONICAL_NAN); // keep NaNs clear of the tagged space
+    }
+    return Value(std::bit_cast<uint64_t>(value));
+  }
+  static Value integer(int32_t value) { return Value(QNAN | TAG_INT | static_cast<uint32_t>(value)); }
+  // Result of integer arithmetic, promoted to a double when out of int32 range
+  static Value integerOrNumber(int64_t value) {
+    if (value >= INT32_MIN && value <= INT32_MAX) {
+      return integer(static_cast<int32_t>(value));
+    }
+    return number(static_cast<double>(value));
+  }
+  static Value boolean(bool value) { return Value(value ? TRUE_BITS : FALSE_BITS); }
+  static Value null() { return Value(NULL_BITS); }
+  static Value object(RuntimeValue* value) { return Value(SIGN | QNAN | reinterpret_cast<uint64_t>(value)); }
+  // Marks a declared but not yet initialised enviroment slot
+  static Value empty() { return Value(EMPTY_BITS); }
 
-struct ReturnValue : RuntimeValue {
-  public:
-  RuntimeValue* value;
+  bool isDouble() const { return (bits & QNAN) != QNAN; }
+  bool isInt() const { return (bits & (SIGN | QNAN | TAG_MASK)) == (QNAN | TAG_INT); }
+  bool isNumber() const { return isDouble() || isInt(); }
+  bool isBool() const { return bits == TRUE_BITS || bits == FALSE_BITS; }
+  bool isNull() const { return bits == NULL_BITS; }
+  bool isEmpty() const { return bits == EMPTY_BITS; }
+  bool isObject() const { return (bits & (SIGN | QNAN)) == (SIGN | QNAN); }
 
-  ReturnValue(RuntimeValue* value) : RuntimeValue(ValueType::RETURN_VALUE), value(value) {};
-};
+  double asDouble() const { return std::bit_cast<double>(bits); }
+  int32_t asInt() const { return static_cast<int32_t>(static_cast<uint32_t>(bits)); }
+  double asNumber() const { return isInt() ? asInt() : asDouble(); }
+  bool asBool() const { return bits == TRUE_BITS; }
+  RuntimeValue* asObject() const { return reinterpret_cast<RuntimeValue*>(bits & ~(SIGN | QNAN)); }
 
-struct NullValue : RuntimeValue {
-  public:
-  std::string value = "null";
-  NullValue() : RuntimeValue(ValueType::NULL_VALUE) {};
+  inline ValueType type() const;
+
+  bool operator==(const Value& other) const { return bits == other.bits; }
+
+  private:
+  static constexpr uint64_t SIGN = 0x8000000000000000;
+  static constexpr uint64_t QNAN = 0x7ffc000000000000;
+  static constexpr uint64_t CANONICAL_NAN = 0x7ff8000000000000;
+  static constexpr uint64_t TAG_MASK = 0x0000000700000000;
+  static constexpr uint64_t TAG_NULL = 0x0000000100000000;
+  static constexpr uint64_t TAG_FALSE = 0x0000000200000000;
+  static constexpr uint64_t TAG_TRUE = 0x0000000300000000;
+  static constexpr uint64_t TAG_INT = 0x0000000400000000;
+  static constexpr uint64_t TAG_EMPTY = 0x0000000500000000;
+  static constexpr uint64_t NULL_BITS = QNAN | TAG_NULL;
+  static constexpr uint64_t FALSE_BITS = QNAN | TAG_FALSE;
+  static constexpr uint64_t TRUE_BITS = QNAN | TAG_TRUE;
+  static constexpr uint64_t EMPTY_BITS = QNAN | TAG_EMPTY;
+
+  uint64_t bits;
+
+  explicit Value(uint64_t bits) : bits(bits) {}
 };
 
-struct NumberValue : RuntimeValue {
+static_assert(sizeof(Value) == 8);
+
+// Heap objects, owned by the Heap (see heap.hpp)
+struct RuntimeValue {
   public:
-  float value;
-  NumberValue(float value) : RuntimeValue(ValueType::NUMBER_VALUE), value(value) {};
+  ValueType type;
+  bool marked = false;         // reached in the current collection
+  RuntimeValue* next = nullptr; // next object allocated by the Heap
+
+  RuntimeValue(ValueType type) : type(type) {} 
+
+  // Every kind of object has a fixed size, they all come from the pools
+  static void* operator new(size_t size) { return Pool::allocate(size); }
+  static void operator delete(void* pointer, size_t size) { Pool::free(pointer, size); }
 };
 
+inline ValueType Value::type() const {
+  if (isNumber()) return ValueType::NUMBER_VALUE;
+  if (isObject()) return asObject()->type;
+  if (isBool()) return ValueType::BOOLEAN_VALUE;
+  return ValueType::NULL_VALUE;
+}
+
+// Signature of functions implemented by the host
+using ExternalFunction = std::function<Value (std::span<const Value> args)>;
+
+// A string is either flat, with its characters in value, or a rope: the
+// concatenation of left and right, only joined the first time its characters
+// are needed. Appending in a loop then costs a node per step instead of a
+// copy of everything built so far
 struct StringValue : RuntimeValue {
   public:
   std::string value;
+  StringValue* left = nullptr;
+  StringValue* right = nullptr;
+  size_t length;
+  size_t hash = 0;
+  bool hashed = false;   // hash is valid
+  bool interned = false; // the Heap's shared copy of these characters
 
-  StringValue(std::string value) : RuntimeValue(ValueType::STRING_VALUE), value(value) {};
-};
+  StringValue(std::string value) : RuntimeValue(ValueType::STRING_VALUE), value(std::move(value)) {
+    length = this->value.size();
+  };
+  StringValue(StringValue* left, StringValue* right) : RuntimeValue(ValueType::STRING_VALUE), left(left), right(right), length(left->length + right->length) {};
 
-struct BooleanValue : RuntimeValue {
-  public:
-  bool value;
-  BooleanValue(bool value) : RuntimeValue(ValueType::BOOLEAN_VALUE), value(value) {};
+  bool isRope() const { return left != nullptr; }
+
+  // The characters of the string, a rope is flattened in place
+  const std::string& flat() { return isRope() ? flatten() : value; }
+
+  size_t hashCode() {
+    if (!hashed) {
+      hash = std::hash<std::string_view>{}(flat());
+      hashed = true;
+    }
+    return hash;
+  }
+
+  bool equals(StringValue* other);
+
+  private:
+  const std::string& flatten();
 };
 
 struct FunctionValue : RuntimeValue {
   public:
-  std::string name;
-  std::vector<std::string> params;
-  std::vector<Statement*> body;
-  std::function<RuntimeValue* (std::vector<RuntimeValue*> args)> extCall = nullptr;
+  std::string_view name;
+  NodeList<std::string_view> params;
+  NodeList<Statement*> body;
+  ExternalFunction extCall = nullptr;
   Enviroment& env;
-  
-  FunctionValue(std::string& name, std::vector<std::string>& params, std::vector<Statement*>& body, std::function<RuntimeValue* (std::vector<RuntimeValue*> args)> extCall, Enviroment& env) : RuntimeValue(ValueType::FUNCTION_VALUE), name(name), params(params), body(body), extCall(extCall), env(env) {}
-};
-
-struct BreakValue : RuntimeValue {
-  public:
-  
-  BreakValue() : RuntimeValue(ValueType::BREAK_VALUE) {};
-};
+  int localCount = 0; // frame size of a call, from the Resolver
+  const Chunk* chunk = nullptr; // compiled body, when running on the VM
 
-struct ContinueValue : RuntimeValue {
-  public:
+  // Tiering state of the JIT (see jit.hpp)
+  uint32_t callCount = 0;
+  JitCode* jitCode = nullptr;
+  bool jitRejected = false;
   
-  ContinueValue() : RuntimeValue(ValueType::CONTINUE_VALUE) {};
+  FunctionValue(std::string_view name, NodeList<std::string_view> params, NodeList<Statement*> body, ExternalFunction extCall, Enviroment& env) : RuntimeValue(ValueType::FUNCTION_VALUE), name(name), params(params), body(body), extCall(extCall), env(env) {}
 };
-
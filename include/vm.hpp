@@ -0,0 +1,41 @@
+#pragma once
+#include "bytecode.hpp"
+#include "enviroment.hpp"
+#include "heap.hpp"
+#include "values.hpp"
+#include <memory>
+#include <vector>
+
+// Runs a compiled Module. Operands live on one fixed size value stack and
+// variables in Enviroment frames, as in the interpreter, so both engines share
+// globals and builtins. Frames are pooled per call depth and reused.
+class VM {
+  public:
+  VM(Module& module, Enviroment& globals);
+  ~VM();
+  VM(const VM&) = delete;
+  VM& operator=(const VM&) = delete;
+
+  Value run();
+
+  private:
+  struct CallFrame {
+    const Chunk* chunk;
+    const uint8_t* ip;
+    Value* base; // first stack slot owned by the call
+    Enviroment* env;
+  };
+
+  static constexpr size_t STACK_SIZE = 1 << 20;
+  static constexpr size_t MAX_FRAMES = 10000;
+
+  Module& module;
+  Enviroment& globals;
+  std::unique_ptr<Value[]> stack;
+  Value* stackTop; // synced from the run loop before anything allocates
+  int rootMarker;  // marks the stack for the Heap
+  std::vector<CallFrame> frames;
+  std::vector<std::unique_ptr<Enviroment>> framePool;
+
+  Enviroment* enterFrame(FunctionValue* function);
+};
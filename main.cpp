@@ -4,20 +4,57 @@
 #include "include/interpreter.hpp"
 #include "include/enviroment.hpp"
 #include "include/builtinFunctions.hpp"
+#include "include/resolver.hpp"
+#include "include/optimizer.hpp"
+#include "include/compiler.hpp"
+#include "include/vm.hpp"
+#include "include/heap.hpp"
+#include "include/jit.hpp"
 #include <string>
 #include <vector>
 
 
 int main(int argc, char* argv[]) {
-  // Get filepath
-  if (argc == 1) {
-    Log::err("At least one file should be given");
-  }
-  if (argc != 2) {
-    Log::err("posea takes only one argument");
+  // Get options and filepath
+  bool useVM = false;
+  bool dumpBytecode = false;
+  bool gcStats = false;
+  bool dumpOptimizedAst = false;
+  std::string filepath;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+
+    if (arg == "--vm") {
+      useVM = true;
+    } else if (arg == "--dump-bytecode") {
+      useVM = true;
+      dumpBytecode = true;
+    } else if (arg == "--dump-optimized-ast") {
+      dumpOptimizedAst = true;
+    } else if (arg == "--gc-stats") {
+      gcStats = true;
+    } else if (arg == "--gc-incremental") {
+      Heap::get().setIncremental(true);
+    } else if (arg == "--jit") {
+      if (!Jit::isSupported()) {
+        Log::err("The JIT is only available on x86-64 Linux");
+      }
+      Jit::get().setEnabled(true);
+    } else if (arg == "--no-jit") {
+      Jit::get().setEnabled(false);
+    } else if (arg.starts_with("--")) {
+      Log::err("Unknown option ", arg);
+    } else if (filepath.empty()) {
+      filepath = arg;
+    } else {
+      Log::err("posea takes only one file");
+    }
   }
 
-  std::string filepath = argv[1];
+  if (filepath.empty()) {
+    Log::err("At least one file should be given");
+  }
 
   Parser parser = Parser();
   Program program = parser.parse(filepath);
@@ -28,17 +65,46 @@ int main(int argc, char* argv[]) {
 
   Enviroment env = Enviroment();
 
-  env.declareVariable("x", new NumberValue(1), true);
+  env.declareVariable("x", Value::number(1), true);
   declarePrintFunction(env);
   declareTypeofFunction(env);
+  declareGcStepFunction(env);
+
+  // Give every variable a slot now that the globals are known
+  Resolver resolver = Resolver(env);
+  resolver.resolve(program);
+
+  // Fold what the source already tells before either engine runs it
+  Optimizer optimizer = Optimizer();
+  optimizer.optimize(program);
+
+  if (dumpOptimizedAst) {
+    Log::printAST(program);
+    return 0;
+  }
+
+  if (useVM) {
+    Compiler compiler = Compiler();
+    auto module = compiler.compile(program);
+
+    if (dumpBytecode) {
+      disassemble(*module);
+      return 0;
+    }
+
+    VM vm(*module, env);
+    vm.run();
+  } else {
+    Interpreter interpreter = Interpreter();
   
-  Interpreter interpreter = Interpreter();
-  
-  auto result = interpreter.evaluate(&program, env);
+    auto result = interpreter.evaluate(&program, env);
   
-  // DEBUG
-  // if (result) {
-  //   Log::printValue(result);
-  // }
-  // END DEBUG
+    // DEBUG
+    // Log::printValue(result);
+    // END DEBUG
+  }
+
+  if (gcStats) {
+    Heap::get().printStats();
+  }
 }
\ No newline at end of file
@@ -1,55 +1,76 @@
 #include "../include/builtinFunctions.hpp"
+#include "../include/operations.hpp"
 
 void declarePrintFunction(Enviroment& env) {
-  std::string fnName = "print"; // function name
+  std::string_view fnName = "print"; // function name
   
-  std::vector<std::string> params = {"toPrint"}; // parameters
-  std::vector<Statement* > body; // body
+  static std::string_view paramNames[] = {"toPrint"};
+  NodeList<std::string_view> params = {paramNames, 1}; // parameters
+  NodeList<Statement*> body; // body
 
-  env.declareVariable(fnName, new FunctionValue(fnName, params, body, [](std::vector<RuntimeValue*> args) -> RuntimeValue* {
+  env.declareVariable(fnName, Value::object(Heap::get().make<FunctionValue>(fnName, params, body, [](std::span<const Value> args) -> Value {
     std::string value = "";
-    for (auto a : args) {
-      if (a->type == ValueType::STRING_VALUE) {
-        value += static_cast<StringValue*>(a)->value;
-      } else if (a->type == ValueType::NUMBER_VALUE) {
-        value += std::to_string(static_cast<NumberValue*>(a)->value);
-      } else if (a->type == ValueType::BOOLEAN_VALUE) {
-        value += std::to_string(static_cast<BooleanValue*>(a)->value);
-      } else if (a->type == ValueType::NULL_VALUE) {
+    for (Value a : args) {
+      if (a.type() == ValueType::STRING_VALUE) {
+        value += static_cast<StringValue*>(a.asObject())->flat();
+      } else if (a.type() == ValueType::NUMBER_VALUE) {
+        value += numberToString(a);
+      } else if (a.type() == ValueType::BOOLEAN_VALUE) {
+        value += std::to_string(a.asBool());
+      } else if (a.type() == ValueType::NULL_VALUE) {
         value += "null";
       } else {
-        Log::err("Unrecognized type ", a->type, " in print function");
+        Log::err("Unrecognized type ", a.type(), " in print function");
       }
     }
     Log::log(value);
-    return new NullValue();
-  }, env), true);
+    return Value::null();
+  }, env)), true);
 }
 
 
 void declareTypeofFunction(Enviroment& env) {
-  std::string fnName = "typeof"; // function name
+  std::string_view fnName = "typeof"; // function name
   
-  std::vector<std::string> params = {"value"}; // parameters
-  std::vector<Statement* > body; // body
+  static std::string_view paramNames[] = {"value"};
+  NodeList<std::string_view> params = {paramNames, 1}; // parameters
+  NodeList<Statement*> body; // body
 
-  env.declareVariable(fnName, new FunctionValue(fnName, params, body, [](std::vector<RuntimeValue*> args) -> RuntimeValue* {
-    RuntimeValue* arg = args[0];
+  env.declareVariable(fnName, Value::object(Heap::get().make<FunctionValue>(fnName, params, body, [](std::span<const Value> args) -> Value {
+    Value arg = args[0];
     std::string type = "";
-    if (arg->type == ValueType::STRING_VALUE) {
+    if (arg.type() == ValueType::STRING_VALUE) {
       type = "string";
-    } else if (arg->type == ValueType::NUMBER_VALUE) {
+    } else if (arg.type() == ValueType::NUMBER_VALUE) {
       type = "number";
-    } else if (arg->type == ValueType::BOOLEAN_VALUE) {
+    } else if (arg.type() == ValueType::BOOLEAN_VALUE) {
       type = "bool";
-    } else if (arg->type == ValueType::NULL_VALUE) {
+    } else if (arg.type() == ValueType::NULL_VALUE) {
       type = "null";
-    } else if (arg->type == ValueType::FUNCTION_VALUE) {
+    } else if (arg.type() == ValueType::FUNCTION_VALUE) {
       type = "function";
     } else {
-      Log::err("Unrecognized type ", arg->type, " in 'typeof' function call");
+      Log::err("Unrecognized type ", arg.type(), " in 'typeof' function call");
     }
     
-    return new StringValue(type);
-  }, env), true);
-}
\ No newline at end of file
+    return Value::object(Heap::get().make<StringValue>(type));
+  }, env)), true);
+}
+
+void declareGcStepFunction(Enviroment& env) {
+  std::string_view fnName = "gcStep"; // function name
+  
+  static std::string_view paramNames[] = {"budgetMicros"};
+  NodeList<std::string_view> params = {paramNames, 1}; // parameters
+  NodeList<Statement*> body; // body
+
+  env.declareVariable(fnName, Value::object(Heap::get().make<FunctionValue>(fnName, params, body, [](std::span<const Value> args) -> Value {
+    Value budget = args[0];
+    if (!budget.isNumber()) {
+      Log::err("gcStep expects a time budget in microseconds");
+    }
+
+    Heap::get().gcStep(static_cast<int64_t>(budget.asNumber()));
+    return Value::null();
+  }, env)), true);
+}
@@ -0,0 +1,47 @@
+#include "../include/bytecode.hpp"
+#include "../include/log.hpp"
+#include <iomanip>
+#include <iostream>
+
+const char* opCodeName(OpCode op) {
+  switch (op) {
+#define BYTECODE_NAME(name, operands, effect) case OpCode::name: return #name;
+    BYTECODE_OPCODES(BYTECODE_NAME)
+#undef BYTECODE_NAME
+  }
+
+  return "UNKNOWN";
+}
+
+int opCodeOperands(OpCode op) {
+  switch (op) {
+#define BYTECODE_OPERANDS(name, operands, effect) case OpCode::name: return operands;
+    BYTECODE_OPCODES(BYTECODE_OPERANDS)
+#undef BYTECODE_OPERANDS
+  }
+
+  return 0;
+}
+
+void disassemble(const Module& module) {
+  for (size_t c = 0; c < module.chunks.size(); ++c) {
+    const Chunk& chunk = *module.chunks[c];
+    std::string_view name = chunk.decl ? chunk.decl->name : "<main>";
+    std::cout << "== chunk " << c << " " << name << " (max stack "
+              << chunk.maxStack << ") ==" << std::endl;
+
+    size_t ip = 0;
+    while (ip < chunk.code.size()) {
+      OpCode op = static_cast<OpCode>(chunk.code[ip]);
+      std::cout << std::setw(5) << ip << "  " << opCodeName(op);
+      ip++;
+
+      for (int i = 0; i < opCodeOperands(op); ++i) {
+        uint16_t operand = chunk.code[ip] | (chunk.code[ip + 1] << 8);
+        std::cout << " " << operand;
+        ip += 2;
+      }
+      std::cout << std::endl;
+    }
+  }
+}
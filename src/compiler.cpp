@@ -0,0 +1,402 @@
+#include "../include/compiler.hpp"
+#include "../include/heap.hpp"
+#include "../include/log.hpp"
+#include <bit>
+#include <limits>
+
+static int stackEffect(OpCode op) {
+  switch (op) {
+#define BYTECODE_EFFECT(name, operands, effect) case OpCode::name: return effect;
+    BYTECODE_OPCODES(BYTECODE_EFFECT)
+#undef BYTECODE_EFFECT
+  }
+
+  return 0;
+}
+
+Compiler::Compiler() {};
+
+std::unique_ptr<Module> Compiler::compile(Program& program) {
+  auto compiled = std::make_unique<Module>();
+  module = compiled.get();
+  module->chunks.push_back(std::make_unique<Chunk>());
+
+  FunctionState main;
+  main.chunk = module->chunks[0].get();
+  state = &main;
+
+  for (auto stmt : program.body) {
+    std::vector<size_t> escapes;
+    state->statementEscapes = &escapes;
+
+    compileStatement(stmt);
+
+    for (auto jump : escapes) {
+      patchJump(jump);
+    }
+    state->statementEscapes = nullptr;
+  }
+
+  emit(OpCode::PUSH_NULL);
+  emit(OpCode::RETURN);
+
+  state = nullptr;
+  module = nullptr;
+  return compiled;
+}
+
+void Compiler::compileBody(NodeList<Statement*>& body) {
+  for (auto stmt : body) {
+    compileStatement(stmt);
+  }
+}
+
+void Compiler::compileStatement(Statement* stmt) {
+  switch (stmt->type) {
+  case NodeType::VAR_DECLARATION: {
+    auto decl = nodeCast<VarDeclaration>(stmt);
+    compileExpression(decl->value);
+    emit(OpCode::DECLARE_VAR);
+    emitOperand(decl->slot);
+    emitOperand(addName(decl->symbol));
+    return;
+  }
+
+  case NodeType::FUNC_DECLARATION: {
+    auto decl = nodeCast<FunctionDeclaration>(stmt);
+    uint16_t index = compileFunction(decl);
+    emit(OpCode::MAKE_FUNCTION);
+    emitOperand(index);
+    return;
+  }
+
+  case NodeType::RETURN_STATEMENT:
+    compileReturn(nodeCast<ReturnStatement>(stmt));
+    return;
+
+  case NodeType::IF_STATEMENT:
+    compileIf(nodeCast<IfStatement>(stmt));
+    return;
+
+  case NodeType::WHILE_STATEMENT:
+    compileWhile(nodeCast<WhileStatement>(stmt));
+    return;
+
+  case NodeType::BREAK_STATEMENT:
+    compileEscape(true);
+    return;
+
+  case NodeType::CONTINUE_STATEMENT:
+    compileEscape(false);
+    return;
+
+  default:
+    compileExpression(stmt);
+    emit(OpCode::POP);
+    return;
+  }
+}
+
+void Compiler::compileExpression(Statement* node) {
+  switch (node->type) {
+  case NodeType::NUMERIC_LITERAL: {
+    auto nLiteral = nodeCast<NumericLiteral>(node);
+    emit(OpCode::CONSTANT);
+    Value number = nLiteral->integer ? Value::integer(static_cast<int32_t>(nLiteral->number)) : Value::number(nLiteral->number);
+    emitOperand(addConstant(number));
+    return;
+  }
+
+  case NodeType::STRING_LITERAL: {
+    auto str = nodeCast<StringLiteral>(node);
+    emit(OpCode::CONSTANT);
+    emitOperand(addConstant(Value::object(Heap::get().intern(str->value))));
+    return;
+  }
+
+  case NodeType::NULL_LITERAL:
+    emit(OpCode::PUSH_NULL);
+    return;
+
+  case NodeType::BOOLEAN_LITERAL: {
+    auto bll = nodeCast<BooleanLiteral>(node);
+    emit(bll->value == "true" ? OpCode::PUSH_TRUE : OpCode::PUSH_FALSE);
+    return;
+  }
+
+  case NodeType::IDENTIFIER_LITERAL: {
+    auto ident = nodeCast<Identifier>(node);
+    compileVariable(OpCode::GET_LOCAL, OpCode::GET_VAR, ident->depth, ident->slot, ident->symbol);
+    return;
+  }
+
+  case NodeType::VAR_ASSIGNMENT: {
+    auto assign = nodeCast<VariableAssignment>(node);
+    compileExpression(assign->expr);
+    if (assign->depth < 0) {
+      // Still fails after the value was evaluated, like the interpreter
+      emit(OpCode::UNDEFINED_VAR);
+      emitOperand(addName(assign->ident));
+      emit(OpCode::POP);
+      return;
+    }
+    compileVariable(OpCode::SET_LOCAL, OpCode::SET_VAR, assign->depth, assign->slot, assign->ident);
+    return;
+  }
+
+  case NodeType::BINARY_EXPRESSION: {
+    auto binExpr = nodeCast<BinaryExpression>(node);
+    compileExpression(binExpr->left);
+    compileExpression(binExpr->right);
+    switch (binExpr->op) {
+    case OP_ADD: emit(OpCode::ADD); break;
+    case OP_SUB: emit(OpCode::SUB); break;
+    case OP_MUL: emit(OpCode::MUL); break;
+    case OP_DIV: emit(OpCode::DIV); break;
+    case OP_MOD: emit(OpCode::MOD); break;
+    }
+    return;
+  }
+
+  case NodeType::COMPARISON_EXPRESSION: {
+    auto comp = nodeCast<ComparisonExpression>(node);
+    compileExpression(comp->lhs);
+    compileExpression(comp->rhs);
+    switch (comp->op) {
+    case OP_EQ: emit(OpCode::EQ); break;
+    case OP_LT: emit(OpCode::LT); break;
+    case OP_LE: emit(OpCode::LE); break;
+    case OP_GT: emit(OpCode::GT); break;
+    case OP_GE: emit(OpCode::GE); break;
+    }
+    return;
+  }
+
+  case NodeType::LOGICAL_EXPRESSION: {
+    auto logic = nodeCast<LogicalExpression>(node);
+    // The left truth stays as the result when it decides, otherwise it is
+    // popped and the right side runs
+    compileExpression(logic->lhs);
+    size_t endJump = emitJump(logic->op == OP_AND ? OpCode::AND : OpCode::OR);
+    compileExpression(logic->rhs);
+    emit(OpCode::TEST);
+    patchJump(endJump);
+    return;
+  }
+
+  case NodeType::CALL_EXPRESSION: {
+    auto expr = nodeCast<CallExpression>(node);
+    if (expr->caller->type != NodeType::IDENTIFIER_LITERAL) {
+      Log::err("Call expression must be called on an identifier");
+    }
+
+    compileExpression(expr->caller);
+    for (auto arg : expr->arguments) {
+      compileExpression(arg);
+    }
+    emit(OpCode::CALL);
+    emitOperand(expr->arguments.size());
+    emitOperand(addName(nodeCast<Identifier>(expr->caller)->symbol));
+    state->stackDepth -= expr->arguments.size();
+    return;
+  }
+
+  default:
+    Log::err("This node has not been setup for compilation: ", node->type);
+  }
+}
+
+void Compiler::compileVariable(OpCode local, OpCode outer, int depth, int slot, std::string_view name) {
+  if (depth < 0) {
+    emit(OpCode::UNDEFINED_VAR);
+    emitOperand(addName(name));
+  } else if (depth == 0) {
+    emit(local);
+    emitOperand(slot);
+    emitOperand(addName(name));
+  } else {
+    emit(outer);
+    emitOperand(depth);
+    emitOperand(slot);
+    emitOperand(addName(name));
+  }
+}
+
+void Compiler::compileIf(IfStatement* ifStmt) {
+  // The outermost if outside of a loop catches stray break / continue
+  std::vector<size_t> escapes;
+  bool catchesEscapes = state->loops.empty() && state->ifEscapes == nullptr;
+  if (catchesEscapes) {
+    state->ifEscapes = &escapes;
+  }
+
+  compileExpression(ifStmt->cond);
+  size_t elseJump = emitJump(OpCode::JUMP_IF_FALSE);
+  compileBody(ifStmt->ifBody);
+
+  if (ifStmt->elseBody.empty()) {
+    patchJump(elseJump);
+  } else {
+    size_t endJump = emitJump(OpCode::JUMP);
+    patchJump(elseJump);
+    compileBody(ifStmt->elseBody);
+    patchJump(endJump);
+  }
+
+  if (catchesEscapes) {
+    for (auto jump : escapes) {
+      patchJump(jump);
+    }
+    state->ifEscapes = nullptr;
+  }
+}
+
+// Rotated loop: the condition is tested once before entering and then at the
+// bottom of every iteration, so each iteration runs a single branch
+void Compiler::compileWhile(WhileStatement* whileStmt) {
+  compileExpression(whileStmt->cond);
+  size_t exitJump = emitJump(OpCode::JUMP_IF_FALSE);
+
+  size_t bodyStart = state->chunk->code.size();
+  state->loops.push_back(Loop{});
+  compileBody(whileStmt->body);
+
+  Loop loop = std::move(state->loops.back());
+  state->loops.pop_back();
+
+  for (auto jump : loop.continues) {
+    patchJump(jump);
+  }
+  compileExpression(whileStmt->cond);
+  emit(OpCode::LOOP_IF_TRUE);
+  emitLoop(bodyStart);
+
+  patchJump(exitJump);
+  for (auto jump : loop.breaks) {
+    patchJump(jump);
+  }
+}
+
+void Compiler::compileReturn(ReturnStatement* ret) {
+  if (ret->value) {
+    compileExpression(ret->value);
+  } else {
+    emit(OpCode::PUSH_NULL);
+  }
+
+  if (state->chunk->decl) {
+    emit(OpCode::RETURN);
+    return;
+  }
+
+  // A return at the top level only stops the statement it is in
+  emit(OpCode::POP);
+  if (state->statementEscapes) {
+    state->statementEscapes->push_back(emitJump(OpCode::JUMP));
+  }
+}
+
+void Compiler::compileEscape(bool isBreak) {
+  if (!state->loops.empty()) {
+    Loop& loop = state->loops.back();
+    (isBreak ? loop.breaks : loop.continues).push_back(emitJump(OpCode::JUMP));
+  } else if (state->ifEscapes) {
+    state->ifEscapes->push_back(emitJump(OpCode::JUMP));
+  }
+}
+
+uint16_t Compiler::compileFunction(FunctionDeclaration* decl) {
+  if (module->chunks.size() > std::numeric_limits<uint16_t>::max()) {
+    Log::err("Too many functions in one program");
+  }
+
+  uint16_t index = module->chunks.size();
+  module->chunks.push_back(std::make_unique<Chunk>());
+
+  FunctionState function;
+  function.chunk = module->chunks[index].get();
+  function.chunk->decl = decl;
+
+  FunctionState* enclosing = state;
+  state = &function;
+
+  compileBody(decl->body);
+  emit(OpCode::PUSH_NULL);
+  emit(OpCode::RETURN);
+
+  state = enclosing;
+  return index;
+}
+
+void Compiler::emit(OpCode op) {
+  state->chunk->code.push_back(static_cast<uint8_t>(op));
+
+  state->stackDepth += stackEffect(op);
+  if (state->stackDepth > state->chunk->maxStack) {
+    state->chunk->maxStack = state->stackDepth;
+  }
+}
+
+void Compiler::emitOperand(size_t operand) {
+  if (operand > std::numeric_limits<uint16_t>::max()) {
+    Log::err("Bytecode operand out of range: ", operand);
+  }
+
+  state->chunk->code.push_back(operand & 0xff);
+  state->chunk->code.push_back(operand >> 8);
+}
+
+size_t Compiler::emitJump(OpCode op) {
+  emit(op);
+  emitOperand(0);
+  return state->chunk->code.size() - 2;
+}
+
+void Compiler::patchJump(size_t operandAt) {
+  size_t offset = state->chunk->code.size() - (operandAt + 2);
+  if (offset > std::numeric_limits<uint16_t>::max()) {
+    Log::err("Jump too long");
+  }
+
+  state->chunk->code[operandAt] = offset & 0xff;
+  state->chunk->code[operandAt + 1] = offset >> 8;
+}
+
+void Compiler::emitLoop(size_t target) {
+  emitOperand(state->chunk->code.size() + 2 - target);
+}
+
+uint16_t Compiler::addConstant(Value value) {
+  uint64_t key = std::bit_cast<uint64_t>(value);
+  auto it = state->constantIndex.find(key);
+  if (it != state->constantIndex.end()) {
+    return it->second;
+  }
+
+  auto& constants = state->chunk->constants;
+  if (constants.size() > std::numeric_limits<uint16_t>::max()) {
+    Log::err("Too many constants in one function");
+  }
+
+  uint16_t index = constants.size();
+  constants.push_back(value);
+  state->constantIndex.emplace(key, index);
+  return index;
+}
+
+uint16_t Compiler::addName(std::string_view name) {
+  auto it = state->nameIndex.find(name);
+  if (it != state->nameIndex.end()) {
+    return it->second;
+  }
+
+  auto& names = state->chunk->names;
+  if (names.size() > std::numeric_limits<uint16_t>::max()) {
+    Log::err("Too many names in one function");
+  }
+
+  uint16_t index = names.size();
+  names.push_back(name);
+  state->nameIndex.emplace(name, index);
+  return index;
+}
@@ -1,68 +1,103 @@
 #include "../include/enviroment.hpp"
+#include "../include/heap.hpp"
 
 Enviroment::Enviroment() {
   this->parent = nullptr;
-  this->variables = std::unordered_map<std::string, RuntimeValue*>();
-  this->constants = std::vector<std::string>();
+  Heap::get().addEnviroment(this);
 }
 
-Enviroment::Enviroment(Enviroment* parentEnv) {
+Enviroment::Enviroment(Enviroment* parentEnv, int slotCount) {
   this->parent = parentEnv;
-  this->variables = std::unordered_map<std::string, RuntimeValue*>();
-  this->constants = std::vector<std::string>();
+  this->storage.resize(slotCount, Value::empty());
+  this->slots = storage;
+  Heap::get().addEnviroment(this);
 }
 
-RuntimeValue* Enviroment::declareVariable(std::string& varname, RuntimeValue* value, bool constant) {
-  if (variables.find(varname) != variables.end()) {
+Enviroment::Enviroment(Enviroment* parentEnv, std::span<Value> slots) {
+  this->parent = parentEnv;
+  this->slots = slots;
+  this->registered = false;
+}
+
+Enviroment::~Enviroment() {
+  if (registered) {
+    Heap::get().removeEnviroment(this);
+  }
+}
+
+void Enviroment::reset(Enviroment* parentEnv, int slotCount) {
+  this->parent = parentEnv;
+  this->storage.assign(slotCount, Value::empty());
+  this->slots = storage;
+}
+
+Value Enviroment::declareVariable(int slot, std::string_view varname, Value value) {
+  if (!slots[slot].isEmpty()) {
     Log::err("Cannot declare variable '", varname, "' as it was already declared");
   }
 
-  variables[varname] = value;
-  
-  if (constant) {
-    constants.push_back(varname);
+  if (value.type() == ValueType::FUNCTION_VALUE) {
+    bindingVersion++;
   }
 
+  Heap::get().writeBarrier(value);
+  slots[slot] = value;
   return value;
 };
 
-RuntimeValue* Enviroment::declareVariable(const char* varname, RuntimeValue* value, bool constant) {
-  std::string sVarname = "";
-  sVarname += varname;
-
-  return declareVariable(sVarname, value, constant);
-};
+Value Enviroment::assignVariable(int depth, int slot, std::string_view varname, Value value) {
+  if (depth < 0) {
+    Log::err("Variable ", varname, " does not exist");
+  }
 
+  Enviroment* env = ancestor(depth);
+  Value old = env->slots[slot];
+  if (old.isEmpty()) {
+    Log::err("Variable ", varname, " does not exist");
+  }
 
-RuntimeValue* Enviroment::assignVariable(std::string& varname, RuntimeValue* value) {
-  Enviroment& env = resolve(varname);
-  
-  for (auto c : env.constants) {
-    if (c == varname) {
-      Log::err("Cannot reassign variable ", varname, " as it is constant");
-    }
+  if (old.type() == ValueType::FUNCTION_VALUE || value.type() == ValueType::FUNCTION_VALUE) {
+    env->bindingVersion++;
   }
 
-  env.variables[varname] = value;
+  Heap::get().writeBarrier(value);
+  env->slots[slot] = value;
   return value;
 };
 
-RuntimeValue* Enviroment::assignVariable(const char* varname, RuntimeValue* value) {
-  std::string sVarname = "";
-  sVarname += varname;
-
-  return assignVariable(sVarname, value);
+void Enviroment::undefinedVariable(std::string_view varname) {
+  Log::err("Variable ", varname, " does not exist");
 };
 
-Enviroment& Enviroment::resolve(std::string& varname) {
-  if (variables.find(varname) != variables.end()) {
-    return *this;
+Value Enviroment::declareVariable(std::string_view varname, Value value, bool constant) {
+  int slot = defineSlot(varname);
+  if (constant) {
+    constantSlots.resize(slots.size());
+    constantSlots[slot] = true;
   }
+  return declareVariable(slot, varname, value);
+};
 
-  if (parent == nullptr) {
-    std::string errMsg;
-    Log::err("Variable ", varname, " does not exist");
+bool Enviroment::isConstant(int slot) const {
+  return slot < static_cast<int>(constantSlots.size()) && constantSlots[slot];
+};
+
+int Enviroment::slotOf(std::string_view varname) {
+  auto it = names.find(Heap::get().intern(varname));
+  return it == names.end() ? -1 : it->second;
+};
+
+// Returns the slot for a global name, adding one if it has none yet
+int Enviroment::defineSlot(std::string_view varname) {
+  const StringValue* name = Heap::get().intern(varname);
+  auto it = names.find(name);
+  if (it != names.end()) {
+    return it->second;
   }
 
-  return parent->resolve(varname);
-}
\ No newline at end of file
+  int slot = slots.size();
+  names.emplace(name, slot);
+  storage.push_back(Value::empty());
+  slots = storage;
+  return slot;
+};
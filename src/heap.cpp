@@ -0,0 +1,360 @@
+#include "../include/heap.hpp"
+#include "../include/enviroment.hpp"
+#include "../include/jit.hpp"
+#include "../include/log.hpp"
+#include <algorithm>
+
+// How many objects are traced or swept between two looks at the clock
+static const int WORK_CHUNK = 64;
+
+Heap Heap::instance;
+
+Heap::Heap() {};
+
+Heap::~Heap() {
+  for (RuntimeValue* list : {objects, sweepList}) {
+    while (list) {
+      RuntimeValue* next = list->next;
+      destroy(list);
+      list = next;
+    }
+  }
+
+  for (auto& [chars, string] : internTable) {
+    delete string;
+  }
+}
+
+void Heap::track(RuntimeValue* object) {
+  object->next = objects;
+  objects = object;
+
+  // Objects created while marking are gray, whatever they already point to
+  // gets traced before the cycle ends
+  if (currentPhase == MARK) {
+    object->marked = true;
+    grayStack.push_back(object);
+  }
+
+  size_t size = sizeOf(object);
+  bytesSinceCollection += size;
+  statistics.bytesLive += size;
+  statistics.bytesAllocated += size;
+  statistics.objectsLive++;
+
+#ifdef GC_STRESS
+  // Collect on every allocation to surface missing roots and barriers
+  threshold = 0;
+#endif
+}
+
+StringValue* Heap::intern(std::string_view chars) {
+  auto it = internTable.find(chars);
+  if (it != internTable.end()) {
+    return it->second;
+  }
+
+  StringValue* string = new StringValue(std::string(chars));
+  string->interned = true;
+  string->hashCode();
+  // Permanently black, marking stops at interned strings
+  string->marked = true;
+
+  internTable.emplace(string->value, string);
+  return string;
+}
+
+void Heap::grow(size_t bytes) {
+  bytesSinceCollection += bytes;
+  statistics.bytesLive += bytes;
+  statistics.bytesAllocated += bytes;
+}
+
+void Heap::pushRoot(Value value) {
+  tempRoots.push_back(value);
+}
+
+void Heap::popRoots(size_t count) {
+  tempRoots.resize(tempRoots.size() - count);
+}
+
+int Heap::addRootMarker(std::function<void(Heap&)> marker) {
+  int id = nextMarkerId++;
+  rootMarkers.emplace_back(id, std::move(marker));
+  return id;
+}
+
+void Heap::removeRootMarker(int id) {
+  std::erase_if(rootMarkers, [id](auto& entry) { return entry.first == id; });
+}
+
+void Heap::addEnviroment(Enviroment* env) {
+  env->prevLive = nullptr;
+  env->nextLive = enviroments;
+  if (enviroments) {
+    enviroments->prevLive = env;
+  }
+  enviroments = env;
+}
+
+void Heap::removeEnviroment(Enviroment* env) {
+  if (env->prevLive) {
+    env->prevLive->nextLive = env->nextLive;
+  } else {
+    enviroments = env->nextLive;
+  }
+  if (env->nextLive) {
+    env->nextLive->prevLive = env->prevLive;
+  }
+}
+
+void Heap::collectIfDue() {
+#ifdef GC_STRESS
+  if (incremental) {
+    gcStep(0);
+    return;
+  }
+#endif
+
+  if (!incremental || bytesSinceCollection >= threshold * HARD_LIMIT_FACTOR) {
+    collect();
+  }
+}
+
+void Heap::collect() {
+  auto start = Clock::now();
+
+  if (currentPhase == IDLE) {
+    beginCycle();
+  }
+  work(start, false);
+
+  recordPause(Clock::now() - start);
+}
+
+void Heap::gcStep(int64_t budgetMicros) {
+  if (currentPhase == IDLE && bytesSinceCollection < threshold) {
+    return;
+  }
+
+  auto start = Clock::now();
+  auto deadline = start + std::chrono::microseconds(budgetMicros);
+
+  if (currentPhase == IDLE) {
+    beginCycle();
+  }
+  work(deadline, true);
+
+  recordPause(Clock::now() - start);
+}
+
+void Heap::beginCycle() {
+  currentPhase = MARK;
+  markRoots();
+}
+
+void Heap::markValue(Value value) {
+  if (value.isObject()) {
+    markObject(value.asObject());
+  }
+}
+
+void Heap::markObject(RuntimeValue* object) {
+  if (object == nullptr || object->marked) {
+    return;
+  }
+
+  object->marked = true;
+  grayStack.push_back(object);
+}
+
+void Heap::markRoots() {
+  // Frames outlive the functions declared in them only by accident (a
+  // closure escaping its frame), so functions do not trace their enviroment:
+  // every frame that is still alive is a root instead
+  for (Enviroment* env = enviroments; env; env = env->nextLive) {
+    for (Value value : env->slots) {
+      markValue(value);
+    }
+  }
+
+  for (Value value : tempRoots) {
+    markValue(value);
+  }
+
+  for (auto& [id, marker] : rootMarkers) {
+    marker(*this);
+  }
+}
+
+// Returns true once the cycle is complete
+bool Heap::work(Clock::time_point deadline, bool bounded) {
+  if (currentPhase == MARK) {
+    if (!traceSome(deadline, bounded)) {
+      return false;
+    }
+    finishMarking();
+  }
+
+  if (currentPhase == SWEEP) {
+    if (!sweepSome(deadline, bounded)) {
+      return false;
+    }
+    finishCycle();
+  }
+
+  return true;
+}
+
+bool Heap::traceSome(Clock::time_point deadline, bool bounded) {
+  int untilCheck = WORK_CHUNK;
+
+  while (!grayStack.empty()) {
+    RuntimeValue* object = grayStack.back();
+    grayStack.pop_back();
+
+    // Ropes are the only objects that point to others
+    if (object->type == ValueType::STRING_VALUE) {
+      StringValue* string = static_cast<StringValue*>(object);
+      if (string->isRope()) {
+        markObject(string->left);
+        markObject(string->right);
+      }
+    }
+
+    if (bounded && --untilCheck == 0) {
+      if (Clock::now() >= deadline) {
+        return grayStack.empty();
+      }
+      untilCheck = WORK_CHUNK;
+    }
+  }
+
+  return true;
+}
+
+// Enviroment stores are covered by the write barrier, but the temporary roots
+// and the engines' stacks change without one. They are scanned again and the
+// rest is traced in one go before sweeping starts
+void Heap::finishMarking() {
+  for (Value value : tempRoots) {
+    markValue(value);
+  }
+
+  for (auto& [id, marker] : rootMarkers) {
+    marker(*this);
+  }
+
+  traceSome(Clock::now(), false);
+
+  // Survivors are moved back to objects as they are swept, new allocations
+  // land there too and are not looked at until the next cycle
+  sweepList = objects;
+  objects = nullptr;
+  currentPhase = SWEEP;
+}
+
+bool Heap::sweepSome(Clock::time_point deadline, bool bounded) {
+  int untilCheck = WORK_CHUNK;
+
+  while (sweepList) {
+    RuntimeValue* object = sweepList;
+    sweepList = object->next;
+
+    if (object->marked) {
+      object->marked = false;
+      object->next = objects;
+      objects = object;
+    } else {
+      statistics.bytesLive -= sizeOf(object);
+      statistics.objectsLive--;
+      destroy(object);
+    }
+
+    if (bounded && --untilCheck == 0) {
+      if (Clock::now() >= deadline) {
+        return sweepList == nullptr;
+      }
+      untilCheck = WORK_CHUNK;
+    }
+  }
+
+  return true;
+}
+
+void Heap::finishCycle() {
+  currentPhase = IDLE;
+  bytesSinceCollection = 0;
+  threshold = std::max(MIN_THRESHOLD, statistics.bytesLive * GROWTH_FACTOR);
+  statistics.collections++;
+}
+
+void Heap::recordPause(Clock::duration pause) {
+  auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(pause);
+  statistics.pauses++;
+  statistics.totalPause += nanos;
+  statistics.maxPause = std::max(statistics.maxPause, nanos);
+
+  int64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(pause).count();
+  size_t bucket = 0;
+  while (bucket < PAUSE_BUCKETS_US.size() && micros >= PAUSE_BUCKETS_US[bucket]) {
+    bucket++;
+  }
+  statistics.pauseHistogram[bucket]++;
+}
+
+size_t Heap::sizeOf(RuntimeValue* object) {
+  switch (object->type) {
+  case ValueType::STRING_VALUE:
+    return sizeof(StringValue) + static_cast<StringValue*>(object)->value.capacity();
+  case ValueType::FUNCTION_VALUE:
+    return sizeof(FunctionValue) + Jit::codeSize(static_cast<FunctionValue*>(object)->jitCode);
+  default:
+    return sizeof(RuntimeValue);
+  }
+}
+
+// RuntimeValue has no virtual destructor, delete through the concrete type
+void Heap::destroy(RuntimeValue* object) {
+  switch (object->type) {
+  case ValueType::STRING_VALUE:
+    delete static_cast<StringValue*>(object);
+    return;
+  case ValueType::FUNCTION_VALUE: {
+    auto function = static_cast<FunctionValue*>(object);
+    Jit::release(function->jitCode);
+    delete function;
+    return;
+  }
+  default:
+    Log::err("Cannot free value of type ", object->type);
+  }
+}
+
+void Heap::printStats() const {
+  using std::chrono::duration;
+  duration<double, std::milli> total = statistics.totalPause;
+  duration<double, std::milli> max = statistics.maxPause;
+
+  std::cerr << "[GC]: mode: " << (incremental ? "incremental" : "stop-the-world") << std::endl;
+  std::cerr << "[GC]: collections: " << statistics.collections << std::endl;
+  std::cerr << "[GC]: bytes allocated: " << statistics.bytesAllocated << std::endl;
+  std::cerr << "[GC]: bytes live: " << statistics.bytesLive << " in "
+            << statistics.objectsLive << " objects" << std::endl;
+  std::cerr << "[GC]: pauses: " << statistics.pauses << ", total: " << total.count()
+            << " ms, max: " << max.count() << " ms" << std::endl;
+
+  for (size_t i = 0; i < statistics.pauseHistogram.size(); i++) {
+    if (statistics.pauseHistogram[i] == 0) {
+      continue;
+    }
+
+    std::cerr << "[GC]:   ";
+    if (i < PAUSE_BUCKETS_US.size()) {
+      std::cerr << "< " << PAUSE_BUCKETS_US[i] << " us: ";
+    } else {
+      std::cerr << ">= " << PAUSE_BUCKETS_US.back() << " us: ";
+    }
+    std::cerr << statistics.pauseHistogram[i] << std::endl;
+  }
+}
@@ -1,712 +1,465 @@
 #include "../include/interpreter.hpp"
+#include "../include/jit.hpp"
+#include <algorithm>
 #include <string>
 #include <format>
 
-Interpreter::Interpreter() {};
+Interpreter::Interpreter() : stack(new Value[STACK_SIZE]) {
+  stackTop = stack.get();
 
-RuntimeValue *Interpreter::evaluate(Statement *stmt, Enviroment &env) {
+  // The frames and the arguments being evaluated are only held on the value
+  // stack, the return value only here while the call unwinds
+  rootMarker = heap.addRootMarker([this](Heap& heap) {
+    for (Value* slot = stack.get(); slot < stackTop; slot++) {
+      heap.markValue(*slot);
+    }
+    heap.markValue(returnValue);
+  });
+};
+
+Interpreter::~Interpreter() {
+  heap.removeRootMarker(rootMarker);
+}
+
+// QUICKENING
+// A binary or comparison node picks a quickened form the first time it runs,
+// from the operand types it sees. The form checks its operands on every run
+// and computes the operation without going through the generic type chains.
+// When the check fails the node deoptimizes: integer forms whose result left
+// the int32 range move on to the numeric form, anything else turns back into
+// the generic node for good
+
+static NodeType numericForm(BinaryOperator op) {
+  switch (op) {
+  case OP_ADD: return NodeType::ADD_NUM_NUM;
+  case OP_SUB: return NodeType::SUB_NUM_NUM;
+  case OP_MUL: return NodeType::MUL_NUM_NUM;
+  case OP_DIV: return NodeType::DIV_NUM_NUM;
+  case OP_MOD: break;
+  }
+  return NodeType::BINARY_EXPRESSION;
+}
+
+static NodeType binaryForm(BinaryOperator op, Value left, Value right) {
+  if (left.isInt() && right.isInt()) {
+    switch (op) {
+    case OP_ADD: return NodeType::ADD_INT_INT;
+    case OP_SUB: return NodeType::SUB_INT_INT;
+    case OP_MUL: return NodeType::MUL_INT_INT;
+    case OP_MOD: return NodeType::MOD_INT_INT;
+    case OP_DIV: return NodeType::DIV_NUM_NUM;
+    }
+  } else if (left.isNumber() && right.isNumber()) {
+    return numericForm(op);
+  } else if (left.type() == ValueType::STRING_VALUE && right.type() == ValueType::STRING_VALUE) {
+    return NodeType::CONCAT_STR_STR;
+  }
+  return NodeType::BINARY_EXPRESSION;
+}
+
+static NodeType comparisonForm(ComparisonOperator op, Value lhs, Value rhs) {
+  if (!lhs.isNumber() || !rhs.isNumber()) {
+    return NodeType::COMPARISON_EXPRESSION;
+  }
+
+  switch (op) {
+  case OP_EQ: return NodeType::EQ_NUM_NUM;
+  case OP_LT: return NodeType::LT_NUM_NUM;
+  case OP_LE: return NodeType::LE_NUM_NUM;
+  case OP_GT: return NodeType::GT_NUM_NUM;
+  case OP_GE: return NodeType::GE_NUM_NUM;
+  }
+  return NodeType::COMPARISON_EXPRESSION;
+}
+
+static bool isIntegerForm(NodeType type) {
+  return type == NodeType::ADD_INT_INT || type == NodeType::SUB_INT_INT ||
+         type == NodeType::MUL_INT_INT || type == NodeType::MOD_INT_INT;
+}
+
+static Value deoptimize(BinaryExpression *bin, Value left, Value right) {
+  if (isIntegerForm(bin->type) && left.isNumber() && right.isNumber()) {
+    bin->type = numericForm(bin->op);
+  } else {
+    bin->type = NodeType::BINARY_EXPRESSION;
+  }
+
+  return calculateBinaryExpression(left, right, bin->op);
+}
+
+static bool deoptimize(ComparisonExpression *comp, Value lhs, Value rhs) {
+  comp->type = NodeType::COMPARISON_EXPRESSION;
+  return calculateComparison(lhs, rhs, comp->op);
+}
+
+// Variables and numbers are read in place, the quickened forms skip a trip
+// through evaluate for their most common operands
+inline Value Interpreter::evaluateOperand(Expression *expr, Enviroment &env) {
+  if (expr->type == NodeType::IDENTIFIER_LITERAL) {
+    auto ident = static_cast<Identifier *>(expr);
+    return env.lookupVariable(ident->depth, ident->slot, ident->symbol);
+  } else if (expr->type == NodeType::NUMERIC_LITERAL) {
+    auto nLiteral = static_cast<NumericLiteral *>(expr);
+    if (nLiteral->integer) {
+      return Value::integer(static_cast<int32_t>(nLiteral->number));
+    }
+    return Value::number(nLiteral->number);
+  }
+
+  return evaluate(expr, env);
+}
+
+Value Interpreter::evaluate(Statement *stmt, Enviroment &env) {
   switch (stmt->type) {
   case NodeType::PROGRAM: {
-    auto program = dynamic_cast<Program *>(stmt);
-    if (!program) {
-      Log::err("Invalid cast to Program");
-    }
+    auto program = nodeCast<Program>(stmt);
     return evaluateProgram(program, env);
   }
 
   case NodeType::NUMERIC_LITERAL: {
-    auto nLiteral = dynamic_cast<NumericLiteral *>(stmt);
-    if (!nLiteral) {
-      Log::err("Invalid cast to NumericLiteral");
-    }
+    auto nLiteral = nodeCast<NumericLiteral>(stmt);
     
-    return new NumberValue(std::stof(nLiteral->value));
+    if (nLiteral->integer) {
+      return Value::integer(static_cast<int32_t>(nLiteral->number));
+    }
+    return Value::number(nLiteral->number);
   }
 
   case NodeType::IDENTIFIER_LITERAL: {
-    auto ident = dynamic_cast<Identifier *>(stmt);
-    if (!ident) {
-      Log::err("Invalid cast to Identifier");
-    }
+    auto ident = nodeCast<Identifier>(stmt);
 
     return evaluateIdentifier(ident, env);
   }
 
   case NodeType::STRING_LITERAL: {
-    auto str = dynamic_cast<StringLiteral *>(stmt);
-    if (!str) {
-      Log::err("Invalid cast to StringLiteral");
-    }
+    auto str = nodeCast<StringLiteral>(stmt);
 
-    return new StringValue(str->value);
+    if (str->interned == nullptr) {
+      str->interned = heap.intern(str->value);
+    }
+    return Value::object(str->interned);
   }
 
   case NodeType::NULL_LITERAL: {
-    auto nll = dynamic_cast<NullLiteral *>(stmt);
-    if (!nll) {
-      Log::err("Invalid cast to NullLiteral");
-    }
-
-    return new NullValue();
+    return Value::null();
   }
 
   case NodeType::BOOLEAN_LITERAL: {
-    auto bll = dynamic_cast<BooleanLiteral *>(stmt);
-    if (!bll) {
-      Log::err("Invalid cast to BooleanLiteral");
-    }
+    auto bll = nodeCast<BooleanLiteral>(stmt);
 
     bool value = bll->value == "true" ? 1 : 0;
-    return new BooleanValue(value);
+    return Value::boolean(value);
   }
 
   case NodeType::VAR_DECLARATION: {
-    auto decl = dynamic_cast<VarDeclaration *>(stmt);
-    if (!decl) {
-      Log::err("Invalid cast to VarDeclaration");
-    }
+    auto decl = nodeCast<VarDeclaration>(stmt);
 
     return evaluateVariableDeclaration(decl, env);
   }
 
   case NodeType::VAR_ASSIGNMENT: {
-    auto assign = dynamic_cast<VariableAssignment *>(stmt);
-    if (!assign) {
-      Log::err("Invalid cast to VariableAssignment");
-    }
+    auto assign = nodeCast<VariableAssignment>(stmt);
 
     return evaluateVariableAssignment(assign, env);
   }
 
   case NodeType::BINARY_EXPRESSION: {
-    auto binExpr = dynamic_cast<BinaryExpression *>(stmt);
-    if (!binExpr) {
-      Log::err("Invalid cast to BinaryExpression");
-    }
+    auto binExpr = nodeCast<BinaryExpression>(stmt);
     return evaluateBinaryExpression(binExpr, env);
   }
 
   case NodeType::FUNC_DECLARATION: {
-    auto fDecl = dynamic_cast<FunctionDeclaration *>(stmt);
-    if (!fDecl) {
-      Log::err("Invalid cast to FunctionDeclaration");
-    }
+    auto fDecl = nodeCast<FunctionDeclaration>(stmt);
     return evaluateFunctionDeclaration(fDecl, env);
   }
 
   case NodeType::CALL_EXPRESSION: {
-    auto callExpr = dynamic_cast<CallExpression *>(stmt);
-    if (!callExpr) {
-      Log::err("Invalid cast to CallExpression");
-    }
+    auto callExpr = nodeCast<CallExpression>(stmt);
     return evaluateCallExpression(callExpr, env);
   }
 
   case NodeType::RETURN_STATEMENT: {
-    auto ret = dynamic_cast<ReturnStatement *>(stmt);
-    if (!ret) {
-      Log::err("Invalid cast to ReturnStatement");
-    }
-
-    RuntimeValue *returnValue = nullptr;
-    if (ret->value == nullptr) {
-      return new ReturnValue(new NullValue());
-    }
+    auto ret = nodeCast<ReturnStatement>(stmt);
 
-    return new ReturnValue(evaluate(ret->value, env));
+    returnValue = ret->value == nullptr ? Value::null() : evaluate(ret->value, env);
+    completion = RETURN_COMPLETION;
+    return returnValue;
   }
 
   case NodeType::COMPARISON_EXPRESSION: {
-    auto compExpr = dynamic_cast<ComparisonExpression *>(stmt);
-    if (!compExpr) {
-      Log::err("Invalid cast to ComparisonExpression");
-    }
+    auto compExpr = nodeCast<ComparisonExpression>(stmt);
     return evaluateComparisonExpression(compExpr, env);
   }
 
   case NodeType::IF_STATEMENT: {
-    auto ifStmt = dynamic_cast<IfStatement *>(stmt);
-    if (!ifStmt) {
-      Log::err("Invalid cast to IfStatement");
-    }
+    auto ifStmt = nodeCast<IfStatement>(stmt);
     return evaluateIfStatement(ifStmt, env);
   }
 
   case NodeType::WHILE_STATEMENT: {
-    auto whileStmt = dynamic_cast<WhileStatement *>(stmt);
-    if (!whileStmt) {
-      Log::err("Invalid cast to WhileStatement");
-    }
+    auto whileStmt = nodeCast<WhileStatement>(stmt);
     return evaluateWhileStatement(whileStmt, env);
   }
 
   case NodeType::BREAK_STATEMENT: {
-    auto breakStmt = dynamic_cast<BreakStatement *>(stmt);
-    if (!breakStmt) {
-      Log::err("Invalid cast to BreakStatement");
-    }
-    return new BreakValue();
+    completion = BREAK_COMPLETION;
+    return Value::null();
   }
 
   case NodeType::CONTINUE_STATEMENT: {
-    auto contStmt = dynamic_cast<ContinueStatement *>(stmt);
-    if (!contStmt) {
-      Log::err("Invalid cast to ContinueStatement");
-    }
-    return new ContinueValue();
+    completion = CONTINUE_COMPLETION;
+    return Value::null();
   }
 
   case NodeType::LOGICAL_EXPRESSION: {
-    auto logiExp = dynamic_cast<LogicalExpression *>(stmt);
-    if (!logiExp) {
-      Log::err("Invalid cast to LogicalExpression");
-    }
+    auto logiExp = nodeCast<LogicalExpression>(stmt);
     return evaluateLogicalExpression(logiExp, env);
   }
 
+  // Quickened forms, the left operand stays rooted in case it is not what
+  // the form expects and the right one allocates
+#define QUICKENED_BINARY(form, guard, result)                                  \
+  case NodeType::form: {                                                       \
+    auto bin = static_cast<BinaryExpression *>(stmt);                          \
+    RootScope roots(heap);                                                     \
+    Value left = roots.root(evaluateOperand(bin->left, env));                  \
+    Value right = evaluateOperand(bin->right, env);                            \
+    if (guard) {                                                               \
+      return result;                                                           \
+    }                                                                          \
+    return deoptimize(bin, left, right);                                       \
+  }
+
+#define INT_GUARD left.isInt() && right.isInt()
+#define NUM_GUARD left.isNumber() && right.isNumber()
+#define INT_RESULT(op) Value::integerOrNumber(int64_t(left.asInt()) op right.asInt())
+// Integer pairs keep integer results, as in calculateBinaryExpression
+#define NUM_RESULT(op) (INT_GUARD) ? INT_RESULT(op) : Value::number(left.asNumber() op right.asNumber())
+
+  QUICKENED_BINARY(ADD_INT_INT, INT_GUARD, INT_RESULT(+))
+  QUICKENED_BINARY(SUB_INT_INT, INT_GUARD, INT_RESULT(-))
+  QUICKENED_BINARY(MUL_INT_INT, INT_GUARD, INT_RESULT(*))
+  QUICKENED_BINARY(MOD_INT_INT, INT_GUARD && right.asInt() != 0, INT_RESULT(%))
+  QUICKENED_BINARY(ADD_NUM_NUM, NUM_GUARD, NUM_RESULT(+))
+  QUICKENED_BINARY(SUB_NUM_NUM, NUM_GUARD, NUM_RESULT(-))
+  QUICKENED_BINARY(MUL_NUM_NUM, NUM_GUARD, NUM_RESULT(*))
+  QUICKENED_BINARY(DIV_NUM_NUM, NUM_GUARD && right.asNumber() != 0,
+                   (INT_GUARD) ? calculateIntegerBinaryExpression(left.asInt(), right.asInt(), OP_DIV)
+                               : Value::number(left.asNumber() / right.asNumber()))
+  QUICKENED_BINARY(CONCAT_STR_STR,
+                   left.type() == ValueType::STRING_VALUE && right.type() == ValueType::STRING_VALUE,
+                   concatStrings(left, right))
+
+#define QUICKENED_COMPARISON(form, op)                                         \
+  case NodeType::form: {                                                       \
+    auto comp = static_cast<ComparisonExpression *>(stmt);                     \
+    RootScope roots(heap);                                                     \
+    Value lhs = roots.root(evaluateOperand(comp->lhs, env));                   \
+    Value rhs = evaluateOperand(comp->rhs, env);                               \
+    if (lhs.isInt() && rhs.isInt()) {                                          \
+      return Value::boolean(lhs.asInt() op rhs.asInt());                       \
+    } else if (lhs.isNumber() && rhs.isNumber()) {                             \
+      return Value::boolean(lhs.asNumber() op rhs.asNumber());                 \
+    }                                                                          \
+    return Value::boolean(deoptimize(comp, lhs, rhs));                         \
+  }
+
+  QUICKENED_COMPARISON(EQ_NUM_NUM, ==)
+  QUICKENED_COMPARISON(LT_NUM_NUM, <)
+  QUICKENED_COMPARISON(LE_NUM_NUM, <=)
+  QUICKENED_COMPARISON(GT_NUM_NUM, >)
+  QUICKENED_COMPARISON(GE_NUM_NUM, >=)
+
+#undef QUICKENED_BINARY
+#undef INT_GUARD
+#undef NUM_GUARD
+#undef INT_RESULT
+#undef NUM_RESULT
+#undef QUICKENED_COMPARISON
+
   default:
     Log::err("This node has not been setup for interpretation: ", stmt->type);
-    return new NullValue();
+    return Value::null();
   }
 }
 
-bool evaluateLogicalExpressionNumeric(bool a, bool b, std::string &op) {
-  if (op == "or") {
-    return a || b;
-  } else if (op == "and") {
-    return a && b;
-  } else {
-    Log::err("Unrecognized logical operator ", op);
-    return false; // unrecheable
-  }
+Value Interpreter::evaluateLogicalExpression(LogicalExpression *logic,
+                                             Enviroment &env) {
+  return Value::boolean(calculateLogical(logic, env));
 }
 
-RuntimeValue *Interpreter::evaluateLogicalExpression(LogicalExpression *logic,
-                                                     Enviroment &env) {
-  auto lhsV = evaluate(logic->lhs, env);
-  auto rhsV = evaluate(logic->rhs, env);
-
-  bool result;
-  if (lhsV->type == ValueType::BOOLEAN_VALUE &&
-      rhsV->type == ValueType::BOOLEAN_VALUE) {
-    result = evaluateLogicalExpressionNumeric(
-        static_cast<BooleanValue *>(lhsV)->value,
-        static_cast<BooleanValue *>(rhsV)->value, logic->op);
-  } else if (lhsV->type == ValueType::NUMBER_VALUE &&
-             rhsV->type == ValueType::NUMBER_VALUE) {
-    bool a = false;
-    bool b = false;
-
-    if (static_cast<NumberValue *>(lhsV)->value == 1)
-      a = true;
-    if (static_cast<NumberValue *>(rhsV)->value == 1)
-      b = true;
-
-    result = evaluateLogicalExpressionNumeric(a, b, logic->op);
-  } else if (lhsV->type == ValueType::NUMBER_VALUE &&
-             rhsV->type == ValueType::BOOLEAN_VALUE) {
-    bool a = false;
-    bool b = static_cast<NumberValue *>(rhsV)->value;
-
-    if (static_cast<NumberValue *>(lhsV)->value == 1)
-      a = true;
-
-    result = evaluateLogicalExpressionNumeric(a, b, logic->op);
-  } else if (lhsV->type == ValueType::BOOLEAN_VALUE &&
-             rhsV->type == ValueType::NUMBER_VALUE) {
-    bool a = static_cast<NumberValue *>(lhsV)->value;
-    bool b = false;
-
-    if (static_cast<NumberValue *>(rhsV)->value == 1)
-      b = true;
-
-    result = evaluateLogicalExpressionNumeric(a, b, logic->op);
-  } else {
-    Log::err("Unsupported logical operation between ", lhsV->type, " and ",
-             rhsV->type);
+// The right side only runs when the left one does not decide the result
+bool Interpreter::calculateLogical(LogicalExpression *logic,
+                                   Enviroment &env) {
+  bool lhs = testOperand(logic->lhs, env);
+  if (logic->op == OP_AND ? !lhs : lhs) {
+    return lhs;
   }
 
-  return new BooleanValue(result);
+  return testOperand(logic->rhs, env);
 }
 
-RuntimeValue *Interpreter::evaluateWhileStatement(WhileStatement *whileStmt,
-                                                  Enviroment &env) {
-  auto evalCond = evaluate(whileStmt->cond, env);
-  bool shouldEvalBody;
-
-  if (evalCond->type == ValueType::BOOLEAN_VALUE) {
-    auto cast = static_cast<BooleanValue *>(evalCond);
-    if (!cast) {
-      Log::err("Error casting BooleanValue");
-    }
-
-    shouldEvalBody = cast->value == 1;
+// Comparisons and logical expressions are tested without boxing their result
+bool Interpreter::testOperand(Expression *expr, Enviroment &env) {
+  if (expr->type == NodeType::COMPARISON_EXPRESSION) {
+    return calculateComparizon(nodeCast<ComparisonExpression>(expr), env);
+  } else if (expr->type == NodeType::LOGICAL_EXPRESSION) {
+    return calculateLogical(nodeCast<LogicalExpression>(expr), env);
+  }
 
-  } else if (evalCond->type == ValueType::NUMBER_VALUE) {
-    auto cast = static_cast<NumberValue *>(evalCond);
-    if (!cast) {
-      Log::err("Error casting NumberValue");
-    }
+  return isLogicallyTrue(evaluate(expr, env));
+}
 
-    shouldEvalBody = cast->value != 0;
-  } else if (evalCond->type == ValueType::NULL_VALUE) {
-    shouldEvalBody = false;
-  } else {
-    Log::err("Cannot handle type ", evalCond->type, " in condition");
+bool Interpreter::testCondition(Expression *cond, Enviroment &env,
+                                bool acceptNull) {
+  if (cond->type == NodeType::COMPARISON_EXPRESSION) {
+    return calculateComparizon(nodeCast<ComparisonExpression>(cond), env);
+  } else if (cond->type == NodeType::LOGICAL_EXPRESSION) {
+    return calculateLogical(nodeCast<LogicalExpression>(cond), env);
   }
 
-  RuntimeValue *toReturn = nullptr;
-  bool breakLoop = false;
+  return isTruthy(evaluate(cond, env), acceptNull);
+}
+
+Value Interpreter::evaluateWhileStatement(WhileStatement *whileStmt,
+                                          Enviroment &env) {
+  bool shouldEvalBody = testCondition(whileStmt->cond, env, true);
 
   while (shouldEvalBody) {
     for (auto stmt : whileStmt->body) {
-      auto value = evaluate(stmt, env);
+      evaluate(stmt, env);
 
-      if (value->type == ValueType::RETURN_VALUE) {
-        toReturn = static_cast<ReturnValue *>(value);
-        breakLoop = true;
-        break;
-      } else if (value->type == ValueType::BREAK_VALUE) {
-        breakLoop = true;
-        break;
-      } else if (value->type == ValueType::CONTINUE_VALUE) {
-        // do not break the loop
+      if (completion != NORMAL_COMPLETION) {
         break;
       }
     }
 
-    if (breakLoop) {
+    // A return keeps unwinding up to the call, break and continue end here
+    if (completion == RETURN_COMPLETION) {
+      break;
+    } else if (completion == BREAK_COMPLETION) {
+      completion = NORMAL_COMPLETION;
       break;
     }
+    completion = NORMAL_COMPLETION;
 
-    evalCond = evaluate(whileStmt->cond, env);
-
-    if (evalCond->type == ValueType::BOOLEAN_VALUE) {
-      auto cast = static_cast<BooleanValue *>(evalCond);
-      if (!cast) {
-        Log::err("Error casting BooleanValue");
-      }
-
-      shouldEvalBody = cast->value == 1;
-
-    } else if (evalCond->type == ValueType::NUMBER_VALUE) {
-      auto cast = static_cast<NumberValue *>(evalCond);
-      if (!cast) {
-        Log::err("Error casting NumberValue");
-      }
-
-      shouldEvalBody = cast->value != 0;
-    } else {
-      Log::err("Cannot handle type ", evalCond->type, " in condition");
-    }
+    shouldEvalBody = testCondition(whileStmt->cond, env, false);
   }
 
-  return toReturn ? toReturn : new NullValue();
+  return Value::null();
 }
 
-RuntimeValue *Interpreter::evaluateIfStatement(IfStatement *ifStmt,
-                                               Enviroment &env) {
-  auto evalCond = evaluate(ifStmt->cond, env);
-  bool shouldEvalBody;
-  if (evalCond->type == ValueType::BOOLEAN_VALUE) {
-    auto cast = static_cast<BooleanValue *>(evalCond);
-    if (!cast) {
-      Log::err("Error casting BooleanValue");
-    }
-
-    shouldEvalBody = cast->value == 1;
-
-  } else if (evalCond->type == ValueType::NUMBER_VALUE) {
-    auto cast = static_cast<NumberValue *>(evalCond);
-    if (!cast) {
-      Log::err("Error casting NumberValue");
-    }
-
-    shouldEvalBody = cast->value != 0;
-  } else if (evalCond->type == ValueType::NULL_VALUE) {
-    shouldEvalBody = false;
-  } else {
-    Log::err("Cannot handle type ", evalCond->type, " in condition");
-  }
-
-  RuntimeValue *toReturn = nullptr;
+Value Interpreter::evaluateIfStatement(IfStatement *ifStmt,
+                                       Enviroment &env) {
+  bool shouldEvalBody = testCondition(ifStmt->cond, env, true);
 
-  if (shouldEvalBody) {
-    for (auto stmt : ifStmt->ifBody) {
-      auto value = evaluate(stmt, env);
+  // Any completion other than normal is left for the enclosing statement
+  auto& body = shouldEvalBody ? ifStmt->ifBody : ifStmt->elseBody;
+  for (auto stmt : body) {
+    evaluate(stmt, env);
 
-      if (value->type == ValueType::RETURN_VALUE) {
-        toReturn = static_cast<ReturnValue *>(value);
-        break;
-      } else if (value->type == ValueType::BREAK_VALUE) {
-        toReturn = static_cast<BreakValue *>(value);
-        break;
-      } else if (value->type == ValueType::CONTINUE_VALUE) {
-        toReturn = static_cast<ContinueValue *>(value);
-        break;
-      }
-    }
-  } else {
-    for (auto stmt : ifStmt->elseBody) {
-      auto value = evaluate(stmt, env);
-
-      if (value->type == ValueType::RETURN_VALUE) {
-        toReturn = static_cast<ReturnValue *>(value);
-        break;
-      } else if (value->type == ValueType::BREAK_VALUE) {
-        toReturn = static_cast<BreakValue *>(value);
-        break;
-      } else if (value->type == ValueType::CONTINUE_VALUE) {
-        toReturn = static_cast<ContinueValue *>(value);
-        break;
-      }
+    if (completion != NORMAL_COMPLETION) {
+      break;
     }
   }
 
-  return toReturn ? toReturn : new NullValue();
+  return Value::null();
 };
 
-RuntimeValue *
+Value
 Interpreter::evaluateComparisonExpression(ComparisonExpression *comp,
                                           Enviroment &env) {
   bool result = calculateComparizon(comp, env);
 
-  return new BooleanValue(result);
+  return Value::boolean(result);
 };
 
 bool Interpreter::calculateComparizon(ComparisonExpression *comp,
                                       Enviroment &env) {
-  RuntimeValue *lhs = evaluate(comp->lhs, env);
-  RuntimeValue *rhs = evaluate(comp->rhs, env);
-  std::string op = comp->op;
-
-  bool result = false;
-
-  if (op == "==") {
-    if (lhs->type == ValueType::NUMBER_VALUE) {
-      auto lhsV = static_cast<NumberValue *>(lhs);
-      if (!lhsV) {
-        Log::err("Error casting NumberValue");
-      }
-
-      if (rhs->type == ValueType::NUMBER_VALUE) {
-        // NUMBER NUMBER
-        auto rhsV = static_cast<NumberValue *>(rhs);
-        if (!rhsV) {
-          Log::err("Error casting NumberValue");
-        }
-        result = lhsV->value == rhsV->value;
-      } else if (rhs->type == ValueType::BOOLEAN_VALUE) {
-        // NUMBER BOOL
-        auto rhsV = static_cast<BooleanValue *>(rhs);
-        if (!rhsV) {
-          Log::err("Error casting BooleanValue");
-        }
-        if (lhsV->value == 1 && rhsV->value == 1) {
-          result = true;
-        } else if (lhsV->value == 0 && rhsV->value == 0) {
-          result = true;
-        }
-      }
-    } else if (lhs->type == ValueType::NULL_VALUE) {
-      auto lhsV = static_cast<NullValue *>(lhs);
-      if (!lhsV) {
-        Log::err("Error casting NullValue");
-      }
-
-      if (rhs->type == ValueType::NULL_VALUE) {
-        auto rhsV = static_cast<NullValue *>(rhs);
-        if (!rhsV) {
-          Log::err("Error casting NullValue");
-        }
+  RootScope roots(heap);
+  Value lhs = roots.root(evaluate(comp->lhs, env));
+  Value rhs = evaluate(comp->rhs, env);
 
-        result = true;
-      }
-    } else if (lhs->type == ValueType::STRING_VALUE) {
-      auto lhsV = static_cast<StringValue *>(lhs);
-      if (!lhsV) {
-        Log::err("Error casting StringValue");
-      }
-
-      if (rhs->type == ValueType::STRING_VALUE) {
-        auto rhsV = static_cast<StringValue *>(rhs);
-        if (!rhsV) {
-          Log::err("Error casting StringValue");
-        }
-
-        result = lhsV->value == rhsV->value;
-      }
-    } else if (lhs->type == ValueType::BOOLEAN_VALUE) {
-      auto lhsV = static_cast<BooleanValue *>(lhs);
-      if (!lhsV) {
-        Log::err("Error casting BooleanValue");
-      }
-
-      if (rhs->type == ValueType::NUMBER_VALUE) {
-        // NUMBER NUMBER
-        auto rhsV = static_cast<NumberValue *>(rhs);
-        if (!rhsV) {
-          Log::err("Error casting NumberValue");
-        }
-        result = lhsV->value == rhsV->value;
-      } else if (rhs->type == ValueType::BOOLEAN_VALUE) {
-        // NUMBER BOOL
-        auto rhsV = static_cast<BooleanValue *>(rhs);
-        if (!rhsV) {
-          Log::err("Error casting BooleanValue");
-        }
-        if (lhsV->value == 1 && rhsV->value == 1) {
-          result = true;
-        } else if (lhsV->value == 0 && rhsV->value == 0) {
-          result = true;
-        }
-      }
-    } else {
-      Log::err("Unrecognized type ", lhs->type, " in comparion");
-    }
-  } else if (op == "<" || op == "<=" || op == ">" ||
-             op == ">=") { // only support number x bool
-    if (lhs->type == ValueType::NUMBER_VALUE) {
-      auto lhsV = static_cast<NumberValue *>(lhs);
-      if (!lhsV) {
-        Log::err("Error casting NumberValue");
-      }
-
-      if (rhs->type == ValueType::NUMBER_VALUE) {
-        // NUMBER NUMBER
-        auto rhsV = static_cast<NumberValue *>(rhs);
-        if (!rhsV) {
-          Log::err("Error casting NumberValue");
-        }
-
-        if (op == "<")
-          return lhsV->value < rhsV->value;
-        else if (op == "<=")
-          return lhsV->value <= rhsV->value;
-        else if (op == ">")
-          return lhsV->value > rhsV->value;
-        else if (op == ">=")
-          return lhsV->value >= rhsV->value;
-        else {
-          Log::err("Unrecognized operator ", op);
-        }
-      } else if (rhs->type == ValueType::BOOLEAN_VALUE) {
-        // NUMBER BOOL
-        auto rhsV = static_cast<BooleanValue *>(rhs);
-        if (!rhsV) {
-          Log::err("Error casting BooleanValue");
-        }
-
-        if (op == "<")
-          return lhsV->value < rhsV->value;
-        else if (op == "<=")
-          return lhsV->value <= rhsV->value;
-        else if (op == ">")
-          return lhsV->value > rhsV->value;
-        else if (op == ">=")
-          return lhsV->value >= rhsV->value;
-        else {
-          Log::err("Unrecognized operator ", op);
-        }
-      }
-    } else if (lhs->type == ValueType::BOOLEAN_VALUE) {
-      auto lhsV = static_cast<BooleanValue *>(lhs);
-      if (!lhsV) {
-        Log::err("Error casting BooleanValue");
-      }
-
-      if (rhs->type == ValueType::NUMBER_VALUE) {
-        // NUMBER NUMBER
-        auto rhsV = static_cast<NumberValue *>(rhs);
-        if (!rhsV) {
-          Log::err("Error casting NumberValue");
-        }
-
-        if (op == "<")
-          return lhsV->value < rhsV->value;
-        else if (op == "<=")
-          return lhsV->value <= rhsV->value;
-        else if (op == ">")
-          return lhsV->value > rhsV->value;
-        else if (op == ">=")
-          return lhsV->value >= rhsV->value;
-        else {
-          Log::err("Unrecognized operator ", op);
-        }
-      } else if (rhs->type == ValueType::BOOLEAN_VALUE) {
-        // NUMBER BOOL
-        auto rhsV = static_cast<BooleanValue *>(rhs);
-        if (!rhsV) {
-          Log::err("Error casting BooleanValue");
-        }
-
-        if (op == "<")
-          return lhsV->value < rhsV->value;
-        else if (op == "<=")
-          return lhsV->value <= rhsV->value;
-        else if (op == ">")
-          return lhsV->value > rhsV->value;
-        else if (op == ">=")
-          return lhsV->value >= rhsV->value;
-        else {
-          Log::err("Unrecognized operator ", op);
-        }
-      }
-    } else {
-      Log::err("Unrecognized type ", lhs->type, " in comparion");
-    }
-  } else {
-    Log::err("Unrecognized comparison operator \"", op, "\"");
+  if (!comp->quickened) {
+    comp->quickened = true;
+    comp->type = comparisonForm(comp->op, lhs, rhs);
   }
-
-  return result;
+  return calculateComparison(lhs, rhs, comp->op);
 };
 
-RuntimeValue *
+Value
 Interpreter::evaluateVariableAssignment(VariableAssignment *assign,
                                         Enviroment &env) {
   auto value = evaluate(assign->expr, env);
 
-  return env.assignVariable(assign->ident, value);
+  return env.assignVariable(assign->depth, assign->slot, assign->ident, value);
 }
 
-RuntimeValue *Interpreter::evaluateVariableDeclaration(VarDeclaration *decl,
-                                                       Enviroment &env) {
+Value Interpreter::evaluateVariableDeclaration(VarDeclaration *decl,
+                                               Enviroment &env) {
   auto value = evaluate(decl->value, env);
 
-  return env.declareVariable(decl->symbol, value, decl->isConstant);
+  return env.declareVariable(decl->slot, decl->symbol, value);
 }
 
-RuntimeValue *Interpreter::evaluateIdentifier(Identifier *ident,
-                                              Enviroment &env) {
-  return env.resolve(ident->symbol)
-      .variables[ident->symbol]; // Return the value
+Value Interpreter::evaluateIdentifier(Identifier *ident,
+                                      Enviroment &env) {
+  return env.lookupVariable(ident->depth, ident->slot, ident->symbol); // Return the value
 }
 
-RuntimeValue *Interpreter::evaluateProgram(Program *program, Enviroment &env) {
-  RuntimeValue *last = nullptr;
+Value Interpreter::evaluateProgram(Program *program, Enviroment &env) {
+  Value last = Value::null();
 
   for (auto stmt : program->body) {
     last = evaluate(stmt, env);
+
+    // return, break and continue at the top level only end their statement
+    if (completion == RETURN_COMPLETION) {
+      last = returnValue;
+    }
+    completion = NORMAL_COMPLETION;
   }
 
   return last;
 }
 
-RuntimeValue *
+Value
 Interpreter::evaluateFunctionDeclaration(FunctionDeclaration *decl,
                                          Enviroment &env) {
-  auto func =
-      new FunctionValue(decl->name, decl->params, decl->body, nullptr, env);
-  return env.declareVariable(decl->name, func, false);
+  auto func = heap.make<FunctionValue>(decl->name, decl->params, decl->body,
+                                       nullptr, env);
+  func->localCount = decl->localCount;
+  return env.declareVariable(decl->slot, decl->name, Value::object(func));
 }
 
-RuntimeValue *Interpreter::evaluateBinaryExpression(BinaryExpression *binExpr,
-                                                    Enviroment &env) {
-  RuntimeValue *left = evaluate(binExpr->left, env);
-  RuntimeValue *right = evaluate(binExpr->right, env);
-
-  if (left->type == ValueType::NUMBER_VALUE &&
-      right->type == ValueType::NUMBER_VALUE) {
-    float result = calculateNumericBinaryExpression(
-        static_cast<NumberValue *>(left)->value,
-        static_cast<NumberValue *>(right)->value, binExpr->op);
-
-    return new NumberValue(result);
-
-  } else if (left->type == ValueType::BOOLEAN_VALUE &&
-             right->type == ValueType::BOOLEAN_VALUE) {
-    bool bLeft = static_cast<BooleanValue *>(left)->value;
-    bool bRight = static_cast<BooleanValue *>(right)->value;
-
-    return new NumberValue(bLeft + bRight);
-
-  } else if (left->type == ValueType::BOOLEAN_VALUE &&
-             right->type == ValueType::NUMBER_VALUE) {
-    bool bLeft = static_cast<BooleanValue *>(left)->value;
-    float nRight = static_cast<NumberValue *>(right)->value;
-
-    return new NumberValue(bLeft + nRight);
-
-  } else if (left->type == ValueType::NUMBER_VALUE &&
-             right->type == ValueType::BOOLEAN_VALUE) {
-    float nLeft = static_cast<NumberValue *>(left)->value;
-    bool bRight = static_cast<BooleanValue *>(right)->value;
-
-    return new NumberValue(nLeft + bRight);
+Value Interpreter::evaluateBinaryExpression(BinaryExpression *binExpr,
+                                            Enviroment &env) {
+  RootScope roots(heap);
+  Value left = roots.root(evaluate(binExpr->left, env));
+  Value right = evaluate(binExpr->right, env);
 
-  } else if (left->type == ValueType::STRING_VALUE &&
-             right->type == ValueType::STRING_VALUE) {
-    std::string sLeft = static_cast<StringValue *>(left)->value;
-    std::string sRight = static_cast<StringValue *>(right)->value;
-    return new StringValue(sLeft + sRight);
-
-  } else if (left->type == ValueType::STRING_VALUE && right->type == ValueType::NUMBER_VALUE) {
-    std::string sLeft = static_cast<StringValue *>(left)->value;
-    std::string sRight = std::to_string(static_cast<NumberValue *>(right)->value);  
-    return new StringValue(sLeft + sRight);
-
-  } else if (left->type == ValueType::NUMBER_VALUE && right->type == ValueType::STRING_VALUE) {
-    std::string sLeft = std::to_string(static_cast<NumberValue *>(left)->value);
-    std::string sRight = static_cast<StringValue *>(right)->value;  
-    return new StringValue(sLeft + sRight);
-    
-  } else if (left->type == ValueType::NULL_VALUE) {
-    return right;
-
-  } else if (right->type == NULL_VALUE) {
-    return left;
+  if (!binExpr->quickened) {
+    binExpr->quickened = true;
+    binExpr->type = binaryForm(binExpr->op, left, right);
   }
-
-  delete left;
-  delete right;
-
-  Log::err("Binary expression not supported for types");
-  return nullptr;
+  return calculateBinaryExpression(left, right, binExpr->op);
 }
 
-float Interpreter::calculateNumericBinaryExpression(float left, float right,
-                                                    const std::string &op) {
-  if (op == "+")
-    return left + right;
-  else if (op == "-")
-    return left - right;
-  else if (op == "*")
-    return left * right;
-  else if (op == "/") {
-    if (right == 0) {
-      Log::err("Division by zero");
-    }
-
-    return left / right;
-  } else if (op == "%") {
-    if (right == 0) {
-      Log::err("Division by zero");
-    }
-    // Get only the integer part
-    return (int)left % (int)right;
-  }
-
-  Log::err("Unknown numeric operator: " + op);
-  return 0.0f;
-}
-
-RuntimeValue *Interpreter::evaluateCallExpression(CallExpression *expr,
-                                                  Enviroment &env) {
-  // Get the function being called
-  auto identifier = dynamic_cast<Identifier *>(expr->caller);
-  if (!identifier) {
+// Looks the callee up and checks it, filling the call site's cache when it
+// is bound in the global enviroment
+FunctionValue* Interpreter::lookupCallee(CallExpression *expr,
+                                         Enviroment &env) {
+  if (expr->caller->type != NodeType::IDENTIFIER_LITERAL) {
     Log::err("Call expression must be called on an identifier");
   }
+  auto identifier = nodeCast<Identifier>(expr->caller);
 
-  // Resolve the function value
-  RuntimeValue *funcVal =
-      env.resolve(identifier->symbol).variables[identifier->symbol];
-  if (!funcVal || funcVal->type != ValueType::FUNCTION_VALUE) {
+  Value funcVal = env.lookupVariable(identifier->depth, identifier->slot, identifier->symbol);
+  if (funcVal.type() != ValueType::FUNCTION_VALUE) {
     Log::err("Attempted to call a non-function: ", identifier->symbol);
   }
 
-  FunctionValue *function = static_cast<FunctionValue *>(funcVal);
+  FunctionValue *function = static_cast<FunctionValue *>(funcVal.asObject());
 
   // Check argument count
   if (expr->arguments.size() != function->params.size()) {
@@ -714,52 +467,72 @@ RuntimeValue *Interpreter::evaluateCallExpression(CallExpression *expr,
              " arguments, but got ", expr->arguments.size());
   }
 
-  // Evaluate arguments
-  std::vector<RuntimeValue *> args;
-  for (auto arg : expr->arguments) {
-    args.push_back(evaluate(arg, env));
-  }
-
-  // Return early if extCall is defined and returns a runtime value that is not
-  // null
-  if (function->extCall != nullptr) {
-    auto value = function->extCall(args);
-    if (value->type == ValueType::STRING_VALUE) {
-      auto cast = static_cast<StringValue *>(value);
-      return new StringValue(cast->value);
-    } else if (value->type == ValueType::NULL_VALUE) {
-      return new NullValue();
-    } else if (value->type == ValueType::NUMBER_VALUE) {
-      auto cast = static_cast<NumberValue *>(value);
-      return new NumberValue(cast->value);
-    } else if (value->type == ValueType::BOOLEAN_VALUE) {
-      auto cast = static_cast<BooleanValue *>(value);
-      return new BooleanValue(cast->value);
-    } else {
-      Log::err("Unsupported value type ", value->type, " returned by extnCall");
-    }
+  if (identifier->global) {
+    Enviroment* scope = env.ancestor(identifier->depth);
+    expr->cachedCallee = function;
+    expr->cachedScope = scope;
+    expr->cachedVersion = scope->bindingVersion;
+    expr->cachedNative = function->extCall != nullptr;
   }
 
-  // Create new function scope
-  Enviroment localEnv(&function->env);
-  for (size_t i = 0; i < function->params.size(); ++i) {
-    localEnv.declareVariable(function->params[i], args[i], false);
+  return function;
+}
+
+Value Interpreter::evaluateCallExpression(CallExpression *expr,
+                                          Enviroment &env) {
+  // A cached callee was already checked against this call site
+  FunctionValue *function;
+  bool native;
+  if (expr->cachedScope != nullptr && expr->cachedVersion == expr->cachedScope->bindingVersion) {
+    function = expr->cachedCallee;
+    native = expr->cachedNative;
+  } else {
+    function = lookupCallee(expr, env);
+    native = function->extCall != nullptr;
   }
 
-  RuntimeValue *returnValue = nullptr;
-  for (auto stmt : function->body) {
-    RuntimeValue *result = evaluate(stmt, localEnv);
+  // The function stays rooted for the call, the arguments or the body may
+  // unbind it
+  RootScope roots(heap);
+  roots.root(Value::object(function));
 
-    if (result && result->type == ValueType::RETURN_VALUE) {
-      returnValue = static_cast<ReturnValue *>(result)->value;
-      break;
-    }
+  // Push the frame, the parameters are its first slots. Calls made while
+  // evaluating the arguments push their frames above it
+  size_t argCount = expr->arguments.size();
+  size_t frameSize = std::max<size_t>(argCount, function->localCount);
+  Value* frame = stackTop;
+  if (frameSize > static_cast<size_t>(stack.get() + STACK_SIZE - frame)) {
+    Log::err("Stack overflow in function ", function->name);
+  }
+  std::fill(frame, frame + frameSize, Value::empty());
+  stackTop = frame + frameSize;
+
+  for (size_t i = 0; i < argCount; ++i) {
+    frame[i] = evaluate(expr->arguments[i], env);
   }
 
-  // Run external call
-  if (function->extCall) {
-    function->extCall(args);
+  // Host functions return their value directly, values are immutable so
+  // nothing needs copying
+  Value result = Value::null();
+  if (native) {
+    result = function->extCall(std::span<const Value>(frame, argCount));
+  } else if (!Jit::get().tryCall(function, std::span<const Value>(frame, argCount), result)) {
+    Enviroment localEnv(&function->env, std::span<Value>(frame, frameSize));
+
+    for (auto stmt : function->body) {
+      evaluate(stmt, localEnv);
+
+      if (completion == RETURN_COMPLETION) {
+        completion = NORMAL_COMPLETION;
+        result = returnValue;
+        break;
+      }
+
+      // break and continue outside a loop only end the statement they are in
+      completion = NORMAL_COMPLETION;
+    }
   }
 
-  return returnValue ? returnValue : new NullValue();
+  stackTop = frame;
+  return result;
 }
@@ -0,0 +1,730 @@
+#include "../include/jit.hpp"
+#include "../include/enviroment.hpp"
+#include "../include/node.hpp"
+#include "../include/heap.hpp"
+#include <cstring>
+#include <memory>
+
+#ifdef JIT_SUPPORTED
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+Jit Jit::instance;
+
+// Scratch of one machine code call, r15 points at it while the code runs
+struct JitState {
+  void* bailSp = nullptr; // stack pointer of the entry, restored by a bailout
+  int64_t status = 0;     // 1 once a guard failed
+  int64_t depth = 0;      // calls of compiled code in progress
+  const char* stackLimit = nullptr; // lowest rsp a compiled frame may reach
+};
+
+struct JitCode {
+  using Entry = int64_t (*)(const int64_t* args, JitState* state);
+
+  void* memory = nullptr;
+  size_t size = 0;
+  Entry entry = nullptr;
+  // Global slot the self calls go through, -1 when the function has none
+  int selfSlot = -1;
+
+  ~JitCode() {
+#ifdef JIT_SUPPORTED
+    if (memory != nullptr) {
+      munmap(memory, size);
+    }
+#endif
+  }
+};
+
+Jit::Jit() {};
+
+Jit::~Jit() {};
+
+size_t Jit::codeSize(const JitCode* code) {
+  return code == nullptr ? 0 : code->size;
+};
+
+void Jit::release(JitCode* code) {
+  delete code;
+};
+
+// The lowest address compiled frames may take the stack of this thread to.
+// Frames are as big as their locals, so MAX_DEPTH alone does not bound it
+static const char* stackLimit() {
+  static thread_local const char* limit = nullptr;
+#ifdef JIT_SUPPORTED
+  if (limit == nullptr) {
+    // Room left below the limit for the bailout and the engine
+    constexpr size_t MARGIN = 256 * 1024;
+
+    pthread_attr_t attr;
+    void* base = nullptr;
+    size_t size = 0;
+    if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+      pthread_attr_getstack(&attr, &base, &size);
+      pthread_attr_destroy(&attr);
+    }
+
+    if (base != nullptr && size > 2 * MARGIN) {
+      limit = static_cast<const char*>(base) + MARGIN;
+    } else {
+      // Unknown bounds, allow a budget below the current frame
+      uintptr_t here = reinterpret_cast<uintptr_t>(__builtin_frame_address(0));
+      limit = reinterpret_cast<const char*>(here - 2 * 1024 * 1024);
+    }
+  }
+#endif
+  return limit;
+};
+
+bool Jit::call(FunctionValue* function, std::span<const Value> args, Value& result) {
+  // The code is specialized for integers, other calls run in the engine
+  for (Value arg : args) {
+    if (!arg.isInt()) {
+      return false;
+    }
+  }
+
+  JitCode* code = function->jitCode;
+  if (code == nullptr) {
+    if (++function->callCount < HOT_THRESHOLD) {
+      return false;
+    }
+
+    code = compile(function);
+    if (code == nullptr) {
+      function->jitRejected = true;
+      return false;
+    }
+    function->jitCode = code;
+    Heap::get().grow(code->size);
+  }
+
+  // Self calls go straight to this function, the engine runs the call while
+  // the name holds something else
+  if (code->selfSlot >= 0 && !(function->env.slots[code->selfSlot] == Value::object(function))) {
+    return false;
+  }
+
+  int64_t argv[MAX_PARAMS];
+  for (size_t i = 0; i < args.size(); i++) {
+    argv[i] = args[i].asInt();
+  }
+
+  JitState state;
+  state.stackLimit = stackLimit();
+  int64_t value = code->entry(argv, &state);
+  if (state.status != 0) {
+    // The code stays with the function until it is collected, it is
+    // already counted as part of it
+    function->jitRejected = true;
+    return false;
+  }
+
+  result = Value::integer(static_cast<int32_t>(value));
+  return true;
+};
+
+#ifndef JIT_SUPPORTED
+
+JitCode* Jit::compile(FunctionValue*) {
+  return nullptr;
+};
+
+#else
+
+// ASSEMBLER
+// Encodes the few x86-64 instructions the templates use. Integers are kept
+// sign extended to 64 bits in registers, arithmetic is done on the low 32
+// bits so the overflow flag tells when a result leaves the int32 range
+
+enum Reg : uint8_t { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+
+enum Cond : uint8_t {
+  CC_O = 0x0,
+  CC_B = 0x2,
+  CC_E = 0x4,
+  CC_NE = 0x5,
+  CC_L = 0xc,
+  CC_GE = 0xd,
+  CC_LE = 0xe,
+  CC_G = 0xf,
+};
+
+class Assembler {
+  public:
+  std::vector<uint8_t> code;
+
+  int newLabel() {
+    labels.push_back(-1);
+    return labels.size() - 1;
+  }
+
+  void bind(int label) { labels[label] = code.size(); }
+
+  void push(Reg reg) {
+    rex(false, 0, reg);
+    byte(0x50 + (reg & 7));
+  }
+
+  void pop(Reg reg) {
+    rex(false, 0, reg);
+    byte(0x58 + (reg & 7));
+  }
+
+  void mov(Reg dst, Reg src) { op(true, 0x89, src, dst); }
+
+  void movImm(Reg dst, int32_t imm) {
+    op(true, 0xc7, 0, dst);
+    imm32(imm);
+  }
+
+  void load(Reg dst, Reg base, int32_t disp) { memOp(true, 0x8b, dst, base, disp); }
+  void store(Reg base, int32_t disp, Reg src) { memOp(true, 0x89, src, base, disp); }
+
+  void add32(Reg dst, Reg src) { op(false, 0x01, src, dst); }
+  void sub32(Reg dst, Reg src) { op(false, 0x29, src, dst); }
+
+  void imul32(Reg dst, Reg src) {
+    rex(false, dst, src);
+    byte(0x0f);
+    byte(0xaf);
+    modrm(3, dst, src);
+  }
+
+  void movsxd(Reg dst, Reg src) { op(true, 0x63, dst, src); }
+  void cmp(Reg left, Reg right) { op(true, 0x39, right, left); }
+  void test(Reg left, Reg right) { op(true, 0x85, right, left); }
+
+  void cqo() {
+    byte(0x48);
+    byte(0x99);
+  }
+
+  void idiv(Reg divisor) { op(true, 0xf7, 7, divisor); }
+
+  void subImm(Reg dst, int32_t imm) {
+    op(true, 0x81, 5, dst);
+    imm32(imm);
+  }
+
+  // 64 bit operations on [base + disp]
+  void incMem(Reg base, int32_t disp) { memOp(true, 0xff, 0, base, disp); }
+  void decMem(Reg base, int32_t disp) { memOp(true, 0xff, 1, base, disp); }
+
+  void cmpMem(Reg left, Reg base, int32_t disp) { memOp(true, 0x3b, left, base, disp); }
+
+  void cmpMemImm(Reg base, int32_t disp, int32_t imm) {
+    memOp(true, 0x81, 7, base, disp);
+    imm32(imm);
+  }
+
+  void storeImm(Reg base, int32_t disp, int32_t imm) {
+    memOp(true, 0xc7, 0, base, disp);
+    imm32(imm);
+  }
+
+  void jmp(int label) {
+    byte(0xe9);
+    rel32(label);
+  }
+
+  void jcc(Cond cond, int label) {
+    byte(0x0f);
+    byte(0x80 | cond);
+    rel32(label);
+  }
+
+  void call(int label) {
+    byte(0xe8);
+    rel32(label);
+  }
+
+  void ret() { byte(0xc3); }
+
+  // Patches the jumps, every label must be bound by now
+  void finish() {
+    for (auto [at, label] : fixups) {
+      int32_t offset = labels[label] - static_cast<int32_t>(at + 4);
+      std::memcpy(&code[at], &offset, 4);
+    }
+  }
+
+  private:
+  std::vector<int32_t> labels;
+  std::vector<std::pair<size_t, int>> fixups;
+
+  void byte(uint8_t value) { code.push_back(value); }
+
+  void imm32(int32_t value) {
+    uint8_t bytes[4];
+    std::memcpy(bytes, &value, 4);
+    code.insert(code.end(), bytes, bytes + 4);
+  }
+
+  void rel32(int label) {
+    fixups.emplace_back(code.size(), label);
+    imm32(0);
+  }
+
+  void rex(bool wide, int reg, int rm) {
+    uint8_t prefix = 0x40 | (wide ? 8 : 0) | (reg & 8 ? 4 : 0) | (rm & 8 ? 1 : 0);
+    if (prefix != 0x40) {
+      byte(prefix);
+    }
+  }
+
+  void modrm(int mod, int reg, int rm) { byte((mod << 6) | ((reg & 7) << 3) | (rm & 7)); }
+
+  // Register to register form
+  void op(bool wide, uint8_t opcode, int reg, int rm) {
+    rex(wide, reg, rm);
+    byte(opcode);
+    modrm(3, reg, rm);
+  }
+
+  // [base + disp32] form, rsp and r12 as a base need a SIB byte
+  void memOp(bool wide, uint8_t opcode, int reg, Reg base, int32_t disp) {
+    rex(wide, reg, base);
+    byte(opcode);
+    modrm(2, reg, base);
+    if ((base & 7) == RSP) {
+      byte(0x24);
+    }
+    imm32(disp);
+  }
+};
+
+// TRANSLATION
+// Expressions leave their value in rax, the left operand of a binary one
+// waits on the machine stack while the right one runs. Locals live in the
+// machine frame at rbp - 8 * (slot + 1). Arguments are passed in the System V
+// registers, r15 holds the JitState for the whole call
+
+static const Reg ARG_REGS[Jit::MAX_PARAMS] = {RDI, RSI, RDX, RCX, R8, R9};
+static const Reg SAVED_REGS[] = {RBX, RBP, R12, R13, R14, R15};
+
+static bool isBinary(NodeType type) {
+  switch (type) {
+    case NodeType::BINARY_EXPRESSION:
+    case NodeType::ADD_INT_INT:
+    case NodeType::SUB_INT_INT:
+    case NodeType::MUL_INT_INT:
+    case NodeType::MOD_INT_INT:
+    case NodeType::ADD_NUM_NUM:
+    case NodeType::SUB_NUM_NUM:
+    case NodeType::MUL_NUM_NUM:
+    case NodeType::DIV_NUM_NUM:
+    case NodeType::CONCAT_STR_STR:
+      return true;
+    default:
+      return false;
+  }
+};
+
+static bool isComparison(NodeType type) {
+  switch (type) {
+    case NodeType::COMPARISON_EXPRESSION:
+    case NodeType::EQ_NUM_NUM:
+    case NodeType::LT_NUM_NUM:
+    case NodeType::LE_NUM_NUM:
+    case NodeType::GT_NUM_NUM:
+    case NodeType::GE_NUM_NUM:
+      return true;
+    default:
+      return false;
+  }
+};
+
+// The condition under which the comparison is when
+static Cond conditionOf(ComparisonOperator op, bool when) {
+  switch (op) {
+    case OP_EQ: return when ? CC_E : CC_NE;
+    case OP_LT: return when ? CC_L : CC_GE;
+    case OP_LE: return when ? CC_LE : CC_G;
+    case OP_GT: return when ? CC_G : CC_LE;
+    case OP_GE: return when ? CC_GE : CC_L;
+  }
+  return CC_E;
+};
+
+class JitCompiler {
+  public:
+  Assembler as;
+  int selfSlot = -1;
+
+  JitCompiler(FunctionValue* function) : function(function) {}
+
+  // Returns false when the function uses something the JIT does not handle
+  bool compile() {
+    size_t paramCount = function->params.size();
+    if (paramCount > Jit::MAX_PARAMS) {
+      return false;
+    }
+
+    int slotCount = std::max<int>(function->localCount, paramCount);
+    declared.assign(slotCount, false);
+    for (size_t i = 0; i < paramCount; i++) {
+      declared[i] = true;
+    }
+
+    bailLabel = as.newLabel();
+    int exitLabel = as.newLabel();
+    functionLabel = as.newLabel();
+
+    // Entry, called from C++ as entry(args, state)
+    for (Reg reg : SAVED_REGS) {
+      as.push(reg);
+    }
+    as.mov(R15, RSI);
+    as.store(R15, offsetof(JitState, bailSp), RSP);
+    as.mov(R10, RDI);
+    for (size_t i = 0; i < paramCount; i++) {
+      as.load(ARG_REGS[i], R10, 8 * i);
+    }
+    as.call(functionLabel);
+
+    as.bind(exitLabel);
+    for (int i = std::size(SAVED_REGS) - 1; i >= 0; i--) {
+      as.pop(SAVED_REGS[i]);
+    }
+    as.ret();
+
+    // Bailout, drops every frame of compiled code at once
+    as.bind(bailLabel);
+    as.load(RSP, R15, offsetof(JitState, bailSp));
+    as.storeImm(R15, offsetof(JitState, status), 1);
+    as.jmp(exitLabel);
+
+    // The function itself
+    as.bind(functionLabel);
+    as.push(RBP);
+    as.mov(RBP, RSP);
+    as.subImm(RSP, (8 * slotCount + 15) & ~15);
+    // Checked before the frame is touched, it may end past the stack
+    as.cmpMem(RSP, R15, offsetof(JitState, stackLimit));
+    as.jcc(CC_B, bailLabel);
+    for (size_t i = 0; i < paramCount; i++) {
+      as.store(RBP, slotOffset(i), ARG_REGS[i]);
+    }
+    as.incMem(R15, offsetof(JitState, depth));
+    as.cmpMemImm(R15, offsetof(JitState, depth), Jit::MAX_DEPTH);
+    as.jcc(CC_G, bailLabel);
+
+    if (!body(function->body, true)) {
+      return false;
+    }
+
+    // Falling off the end returns null, which the engine takes care of
+    as.jmp(bailLabel);
+    as.finish();
+    return true;
+  }
+
+  private:
+  struct Loop {
+    int start;
+    int end;
+  };
+
+  FunctionValue* function;
+  int bailLabel = -1;
+  int functionLabel = -1;
+  std::vector<bool> declared; // slots that surely hold a value by now
+  std::vector<Loop> loops;
+
+  static int32_t slotOffset(int slot) { return -8 * (slot + 1); }
+
+  // Declarations are only taken at the top of the body, where each one
+  // runs exactly once before the statements after it
+  bool body(NodeList<Statement*>& stmts, bool topLevel) {
+    for (auto stmt : stmts) {
+      if (!statement(stmt, topLevel)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool statement(Statement* stmt, bool topLevel) {
+    switch (stmt->type) {
+      case NodeType::VAR_DECLARATION: {
+        auto decl = nodeCast<VarDeclaration>(stmt);
+        if (!topLevel || declared[decl->slot] || !expression(decl->value)) {
+          return false;
+        }
+        as.store(RBP, slotOffset(decl->slot), RAX);
+        declared[decl->slot] = true;
+        return true;
+    }
+
+    case NodeType::VAR_ASSIGNMENT: {
+      auto assign = nodeCast<VariableAssignment>(stmt);
+      if (assign->depth != 0 || !declared[assign->slot] || !expression(assign->expr)) {
+        return false;
+      }
+      as.store(RBP, slotOffset(assign->slot), RAX);
+      return true;
+    }
+
+    case NodeType::RETURN_STATEMENT: {
+      auto ret = nodeCast<ReturnStatement>(stmt);
+      if (ret->value == nullptr || !expression(ret->value)) {
+        return false;
+      }
+      as.decMem(R15, offsetof(JitState, depth));
+      as.mov(RSP, RBP);
+      as.pop(RBP);
+      as.ret();
+      return true;
+    }
+
+    case NodeType::IF_STATEMENT: {
+      auto ifStmt = nodeCast<IfStatement>(stmt);
+      int elseLabel = as.newLabel();
+      int endLabel = as.newLabel();
+
+      if (!branch(ifStmt->cond, false, elseLabel) || !body(ifStmt->ifBody, false)) {
+        return false;
+      }
+      as.jmp(endLabel);
+      as.bind(elseLabel);
+      if (!body(ifStmt->elseBody, false)) {
+        return false;
+      }
+      as.bind(endLabel);
+      return true;
+    }
+
+    case NodeType::WHILE_STATEMENT: {
+      auto whileStmt = nodeCast<WhileStatement>(stmt);
+      Loop loop{as.newLabel(), as.newLabel()};
+
+      as.bind(loop.start);
+      if (!branch(whileStmt->cond, false, loop.end)) {
+        return false;
+      }
+      loops.push_back(loop);
+      bool compiled = body(whileStmt->body, false);
+      loops.pop_back();
+      if (!compiled) {
+        return false;
+      }
+      as.jmp(loop.start);
+      as.bind(loop.end);
+      return true;
+    }
+
+    // Outside of a loop they only end their statement, left to the engines
+    case NodeType::BREAK_STATEMENT:
+    case NodeType::CONTINUE_STATEMENT:
+      if (loops.empty()) {
+        return false;
+      }
+      as.jmp(stmt->type == NodeType::BREAK_STATEMENT ? loops.back().end : loops.back().start);
+      return true;
+
+    default:
+      return false;
+    }
+  }
+
+  // Integer expressions only, the value ends up in rax
+  bool expression(Expression* expr) {
+    if (isBinary(expr->type)) {
+      return binary(static_cast<BinaryExpression*>(expr));
+    }
+
+    switch (expr->type) {
+      case NodeType::NUMERIC_LITERAL: {
+        auto num = nodeCast<NumericLiteral>(expr);
+        if (!num->integer) {
+          return false;
+        }
+        as.movImm(RAX, static_cast<int32_t>(num->number));
+        return true;
+    }
+
+    case NodeType::IDENTIFIER_LITERAL: {
+      auto ident = nodeCast<Identifier>(expr);
+      if (ident->depth != 0 || !declared[ident->slot]) {
+        return false;
+      }
+      as.load(RAX, RBP, slotOffset(ident->slot));
+      return true;
+    }
+
+    case NodeType::CALL_EXPRESSION:
+      return selfCall(nodeCast<CallExpression>(expr));
+
+    default:
+      return false;
+    }
+  }
+
+  bool operands(Expression* left, Expression* right) {
+    if (!expression(left)) {
+      return false;
+    }
+    as.push(RAX);
+    if (!expression(right)) {
+      return false;
+    }
+    as.mov(RCX, RAX);
+    as.pop(RAX);
+    return true;
+  }
+
+  bool binary(BinaryExpression* bin) {
+    if (!operands(bin->left, bin->right)) {
+      return false;
+    }
+
+    switch (bin->op) {
+      case OP_ADD:
+      case OP_SUB:
+      case OP_MUL:
+        if (bin->op == OP_ADD) {
+          as.add32(RAX, RCX);
+        } else if (bin->op == OP_SUB) {
+          as.sub32(RAX, RCX);
+        } else {
+          as.imul32(RAX, RCX);
+        }
+        // The engines promote the result to a double
+        as.jcc(CC_O, bailLabel);
+        as.movsxd(RAX, RAX);
+        return true;
+
+      case OP_DIV:
+      case OP_MOD:
+        as.test(RCX, RCX);
+        as.jcc(CC_E, bailLabel);
+        as.cqo();
+        as.idiv(RCX);
+        if (bin->op == OP_MOD) {
+          as.mov(RAX, RDX);
+          return true;
+        }
+
+        // Inexact quotients are doubles, so is INT32_MIN / -1
+        as.test(RDX, RDX);
+        as.jcc(CC_NE, bailLabel);
+        as.movsxd(RCX, RAX);
+        as.cmp(RCX, RAX);
+        as.jcc(CC_NE, bailLabel);
+        return true;
+    }
+    return false;
+  }
+
+  // Only calls through a global binding that holds this very function
+  bool selfCall(CallExpression* call) {
+    if (call->caller->type != NodeType::IDENTIFIER_LITERAL) {
+      return false;
+    }
+    auto ident = nodeCast<Identifier>(call->caller);
+    Enviroment& env = function->env;
+
+    // Declared at the top of the program, so the name is one scope up
+    if (!ident->global || ident->depth != 1 || env.parent != nullptr ||
+        ident->slot < 0 || ident->slot >= static_cast<int>(env.slots.size()) ||
+        !(env.slots[ident->slot] == Value::object(function)) ||
+        call->arguments.size() != function->params.size() ||
+        (selfSlot >= 0 && ident->slot != selfSlot)) {
+      return false;
+    }
+
+    for (auto arg : call->arguments) {
+      if (!expression(arg)) {
+        return false;
+      }
+      as.push(RAX);
+    }
+    for (int i = call->arguments.size() - 1; i >= 0; i--) {
+      as.pop(ARG_REGS[i]);
+    }
+    as.call(functionLabel);
+
+    selfSlot = ident->slot;
+    return true;
+  }
+
+  // Jumps to target when the condition is when, falls through otherwise
+  bool branch(Expression* cond, bool when, int target) {
+    if (isComparison(cond->type)) {
+      auto comp = static_cast<ComparisonExpression*>(cond);
+      if (!operands(comp->lhs, comp->rhs)) {
+        return false;
+      }
+      as.cmp(RAX, RCX);
+      as.jcc(conditionOf(comp->op, when), target);
+      return true;
+    }
+
+    switch (cond->type) {
+      case NodeType::LOGICAL_EXPRESSION: {
+        auto logic = nodeCast<LogicalExpression>(cond);
+        // and jumps on false as soon as one side is false, or on true as soon
+        // as one side is true; the other way round both sides are needed
+        bool decidedByLhs = logic->op == OP_AND ? !when : when;
+        if (decidedByLhs) {
+          return branch(logic->lhs, when, target) && branch(logic->rhs, when, target);
+        }
+
+        int skip = as.newLabel();
+        if (!branch(logic->lhs, !when, skip) || !branch(logic->rhs, when, target)) {
+          return false;
+        }
+        as.bind(skip);
+        return true;
+    }
+
+    case NodeType::BOOLEAN_LITERAL:
+      if ((nodeCast<BooleanLiteral>(cond)->value == "true") == when) {
+        as.jmp(target);
+      }
+      return true;
+
+    default:
+      return false;
+    }
+  }
+};
+
+JitCode* Jit::compile(FunctionValue* function) {
+  if (function->extCall != nullptr) {
+    return nullptr;
+  }
+
+  JitCompiler compiler(function);
+  if (!compiler.compile()) {
+    return nullptr;
+  }
+
+  size_t pageSize = sysconf(_SC_PAGESIZE);
+  size_t size = (compiler.as.code.size() + pageSize - 1) & ~(pageSize - 1);
+  void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (memory == MAP_FAILED) {
+    return nullptr;
+  }
+
+  // Never writable and executable at once
+  std::memcpy(memory, compiler.as.code.data(), compiler.as.code.size());
+  if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+    munmap(memory, size);
+    return nullptr;
+  }
+
+  auto code = std::make_unique<JitCode>();
+  code->memory = memory;
+  code->size = size;
+  code->entry = reinterpret_cast<JitCode::Entry>(memory);
+  code->selfSlot = compiler.selfSlot;
+  return code.release();
+};
+
+#endif
@@ -1,174 +1,114 @@
 #include "../include/lexer.hpp"
 #include "../include/token.hpp"
 #include "../include/log.hpp"
+#include "../include/keywords.hpp"
 #include <string>
-#include <fstream>
-#include <iostream>
 #include <cctype>  // for isdigit()
 
-Lexer::Lexer() {}
+Lexer::Lexer() : scan(&scanKernels()) {}
 
-std::vector<Token> Lexer::tokenize(std::string filepath) {
-  std::ifstream file(filepath);
+Lexer::Lexer(const ScanKernels& kernels) : scan(&kernels) {}
 
-  if (!file) {
-    Log::err("Error opening file: ", filepath);  
-    std::exit(EXIT_FAILURE);
-  }
+void Lexer::open(std::string& filepath) {
+  source = std::make_shared<SourceFile>(filepath);
 
-  char c;
-  int line = 1;
-  while (file.get(c)) {
-    if (c == '\n') {
-      // Check for newline token before check for white spaces
-      line++;
+  std::string_view text = source->text();
+  cursor = text.data();
+  end = text.data() + text.size();
+  line = 1;
+}
 
-      while (file.peek() != EOF && file.peek() == '\n') {
-        line++;
-        file.get(c);
-      }
-
-      continue;
+// Scans and returns the next token in the source. Token values are views into
+// the mapped file, so nothing is copied. Once the end of the source is reached
+// every call returns an END_OF_FILE token
+Token Lexer::next() {
+  while (true) {
+    // Skip white spaces and new lines
+    cursor = scan->skipSpaces(cursor, end, line);
+    if (cursor >= end) {
+      break;
     }
-    else if (isspace(c)) {
-      // Check for white spaces
-      continue;
-    } else if (c == '#') {
+
+    const char* start = cursor;
+    char c = *cursor++;
+
+    if (c == '#') {
       // Check for comments
-      while (file.peek() != EOF && file.peek() != '\n') {
-        file.get(c);
+      cursor = scan->findNewline(cursor, end);
+      if (cursor < end) {
+        line++;
+        cursor++;
       }
-      if (file.peek() == '\n') line++;
-      file.get(c);
     } else if (c == ';') {
-      tokens.push_back(Token(TokenType::SEMICOLON, ";", line));
-
-      while (file.peek() != EOF && file.peek() == ';') {
-        file.get(c);
+      while (cursor < end && *cursor == ';') {
+        cursor++;
       }
 
-      continue;
+      return Token(TokenType::SEMICOLON, std::string_view(start, 1), line);
     } else if (c == '.') {
-      tokens.push_back(Token(TokenType::DOT, ".", line));
+      return Token(TokenType::DOT, std::string_view(start, 1), line);
     } else if (c == ',') {
-      tokens.push_back(Token(TokenType::COMMA, ",", line));
+      return Token(TokenType::COMMA, std::string_view(start, 1), line);
     } else if (c == '{') {
-      tokens.push_back(Token(TokenType::OPEN_BRACE, "{", line));
+      return Token(TokenType::OPEN_BRACE, std::string_view(start, 1), line);
     } else if (c == '}') {
-      tokens.push_back(Token(TokenType::CLOSE_BRACE, "}", line));
+      return Token(TokenType::CLOSE_BRACE, std::string_view(start, 1), line);
     } else if (c == '(') {
-      tokens.push_back(Token(TokenType::OPEN_PARENT, "(", line));
+      return Token(TokenType::OPEN_PARENT, std::string_view(start, 1), line);
     } else if (c == ')') {
-      tokens.push_back(Token(TokenType::CLOSE_PARENT, ")", line));
+      return Token(TokenType::CLOSE_PARENT, std::string_view(start, 1), line);
     } else if (c == '=') {
-      if (file.peek() == '=') {
+      if (cursor < end && *cursor == '=') {
         // Separate '=' / '=='
-        file.get(c);
-        tokens.push_back(Token(TokenType::COMPARISON, "==", line));
-        continue;
-      }
-
-      tokens.push_back(Token(TokenType::EQUAL, "=", line));
-    } else if (c == '<') {
-      if (file.peek() == '=') {
-        // Separate '<' / '<='
-        file.get(c);
-        tokens.push_back(Token(TokenType::COMPARISON, "<=", line));
-        continue;
+        cursor++;
+        return Token(TokenType::COMPARISON, std::string_view(start, 2), line);
       }
 
-      tokens.push_back(Token(TokenType::COMPARISON, "<", line));
-    } else if (c == '>') {
-      if (file.peek() == '=') {
-        // Separate '>' / '>='
-        file.get(c);
-        tokens.push_back(Token(TokenType::COMPARISON, ">=", line));
-        continue;
+      return Token(TokenType::EQUAL, std::string_view(start, 1), line);
+    } else if (c == '<' || c == '>') {
+      if (cursor < end && *cursor == '=') {
+        // Separate '<' / '<=' and '>' / '>='
+        cursor++;
+        return Token(TokenType::COMPARISON, std::string_view(start, 2), line);
       }
 
-      tokens.push_back(Token(TokenType::COMPARISON, ">", line));
+      return Token(TokenType::COMPARISON, std::string_view(start, 1), line);
     } else if (c == '"') {
-      std::string str = "";
-      file.get(c); // advance "
-      
-      while (file.peek() != EOF && c != '"') {
-        str += c;
-        file.get(c);
-      }
+      const char* body = cursor;
+      cursor = scan->findQuote(cursor, end);
+
+      std::string_view str(body, cursor - body);
+      if (cursor < end) cursor++; // advance "
 
-      tokens.push_back(Token(TokenType::STRING, str, line));
+      return Token(TokenType::STRING, str, line);
     }  else if (c == '+' || c == '-' || c == '*' || c == '/' || c == '%') {
-      std::string op; op += c;
-      tokens.push_back(Token(TokenType::BINARY_OP, op, line));
-    } else if (std::isdigit(c)) {
+      return Token(TokenType::BINARY_OP, std::string_view(start, 1), line);
+    } else if (std::isdigit(static_cast<unsigned char>(c))) {
       // Make numbers
-      std::string number;
-      number += c;
-
-      while (file.peek() != EOF && std::isdigit(file.peek())) {
-        file.get(c);
-        number += c;
+      cursor = scan->skipDigits(cursor, end);
+
+      // Literals without a decimal point are integers
+      TokenType type = TokenType::INTEGER;
+      if (cursor < end && *cursor == '.') {
+        cursor++;
+        cursor = scan->skipDigits(cursor, end);
+        type = TokenType::NUMBER;
       }
 
-      if (file.peek() == '.') {
-        file.get(c);
-        number += c;
-
-        while (file.peek() != EOF && std::isdigit(file.peek())) {
-          file.get(c);
-          number += c;
-        }
-      }
+      return Token(type, std::string_view(start, cursor - start), line);
 
-      tokens.push_back(Token(TokenType::NUMBER, number, line));
-
-    } else if (std::isalpha(c) || c == '_') { // Check for '_' character at identifier beginning
+    } else if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') { // Check for '_' character at identifier beginning
       // Make Identifiers and keywords
-      std::string ident;
-      ident += c;
+      cursor = scan->skipIdentifier(cursor, end);
 
-      while (file.peek() != EOF && (std::isalnum(file.peek()) || file.peek() == '_')) {
-        file.get(c);
-        ident += c;
-      }
+      std::string_view ident(start, cursor - start);
 
       // Check for predefined keywords
-      if (ident == "let") {
-        tokens.push_back(Token(TokenType::LET, ident, line));
-      } else if (ident == "const") {
-        tokens.push_back(Token(TokenType::CONST, ident, line));
-      } else if (ident == "def") {
-        tokens.push_back(Token(TokenType::DEF, ident, line));
-      } else if (ident == "return") {
-        tokens.push_back(Token(TokenType::RETURN, ident, line));
-      } else if (ident == "null") {
-        tokens.push_back(Token(TokenType::NULL_TOKEN, ident, line));
-      } else if (ident == "true" || ident == "false") {
-        tokens.push_back(Token(TokenType::BOOLEAN_TOKEN, ident, line));
-      } else if (ident == "if") {
-        tokens.push_back(Token(TokenType::IF, ident, line));
-      } else if (ident == "else") {
-        tokens.push_back(Token(TokenType::ELSE, ident, line));
-      } else if (ident == "while") {
-        tokens.push_back(Token(TokenType::WHILE, ident, line));
-      } else if (ident == "break") {
-        tokens.push_back(Token(TokenType::BREAK, ident, line));
-      } else if (ident == "continue") {
-        tokens.push_back(Token(TokenType::CONTINUE, ident, line));
-      } else if (ident == "and") {
-        tokens.push_back(Token(TokenType::AND, ident, line));
-      } else if (ident == "or") {
-        tokens.push_back(Token(TokenType::OR, ident, line));
-      } else {
-        tokens.push_back(Token(TokenType::IDENTIFIER, ident, line));
-      }
+      return Token(keywordType(ident), ident, line);
     } else {
       Log::err("Unrecognized character: ", c);
     }
   }
 
-  // Add eof token in the very end
-  tokens.push_back(Token(TokenType::END_OF_FILE, "EOF", line));
-
-  return this->tokens;
-}
\ No newline at end of file
+  return Token(TokenType::END_OF_FILE, "EOF", line);
+}
@@ -1 +1,31 @@
-#include "../include/node.hpp"
\ No newline at end of file
+#include "../include/node.hpp"
+
+const char* operatorSymbol(BinaryOperator op) {
+  switch (op) {
+    case OP_ADD: return "+";
+    case OP_SUB: return "-";
+    case OP_MUL: return "*";
+    case OP_DIV: return "/";
+    case OP_MOD: return "%";
+  }
+  return "?";
+}
+
+const char* operatorSymbol(ComparisonOperator op) {
+  switch (op) {
+    case OP_EQ: return "==";
+    case OP_LT: return "<";
+    case OP_LE: return "<=";
+    case OP_GT: return ">";
+    case OP_GE: return ">=";
+  }
+  return "?";
+}
+
+const char* operatorSymbol(LogicalOperator op) {
+  switch (op) {
+    case OP_AND: return "and";
+    case OP_OR: return "or";
+  }
+  return "?";
+}
@@ -0,0 +1,272 @@
+#include "../include/operations.hpp"
+#include "../include/log.hpp"
+#include "../include/heap.hpp"
+#include <string>
+
+double calculateNumericBinaryExpression(double left, double right,
+                                        BinaryOperator op) {
+  switch (op) {
+  case OP_ADD:
+    return left + right;
+  case OP_SUB:
+    return left - right;
+  case OP_MUL:
+    return left * right;
+  case OP_DIV:
+    if (right == 0) {
+      Log::err("Division by zero");
+    }
+
+    return left / right;
+  case OP_MOD: {
+    // Get only the integer part
+    int64_t divisor = static_cast<int64_t>(right);
+    if (divisor == 0) {
+      Log::err("Division by zero");
+    }
+
+    return static_cast<double>(static_cast<int64_t>(left) % divisor);
+  }
+  }
+
+  Log::err("Unknown numeric operator: ", operatorSymbol(op));
+  return 0.0;
+}
+
+// The operands are int32 values, so none of these overflow an int64
+Value calculateIntegerBinaryExpression(int64_t left, int64_t right,
+                                       BinaryOperator op) {
+  switch (op) {
+  case OP_ADD:
+    return Value::integerOrNumber(left + right);
+  case OP_SUB:
+    return Value::integerOrNumber(left - right);
+  case OP_MUL:
+    return Value::integerOrNumber(left * right);
+  case OP_DIV:
+    if (right == 0) {
+      Log::err("Division by zero");
+    }
+
+    if (left % right == 0) {
+      return Value::integerOrNumber(left / right);
+    }
+    return Value::number(static_cast<double>(left) / static_cast<double>(right));
+  case OP_MOD:
+    if (right == 0) {
+      Log::err("Division by zero");
+    }
+
+    return Value::integerOrNumber(left % right);
+  }
+
+  Log::err("Unknown numeric operator: ", operatorSymbol(op));
+  return Value::null();
+}
+
+std::string numberToString(Value number) {
+  if (number.isInt()) {
+    return std::to_string(number.asInt());
+  }
+  return std::to_string(number.asDouble());
+}
+
+// Results shorter than this are copied, a rope node would cost more than that
+static const size_t MIN_ROPE_LENGTH = 64;
+
+Value concatStrings(Value left, Value right) {
+  StringValue* sLeft = static_cast<StringValue *>(left.asObject());
+  StringValue* sRight = static_cast<StringValue *>(right.asObject());
+
+  if (sLeft->length + sRight->length < MIN_ROPE_LENGTH) {
+    return Value::object(Heap::get().make<StringValue>(sLeft->flat() + sRight->flat()));
+  }
+
+  // Both halves must survive a collection run by the allocation of the node
+  RootScope roots(Heap::get());
+  roots.root(left);
+  roots.root(right);
+  return Value::object(Heap::get().make<StringValue>(sLeft, sRight));
+}
+
+// The text of the number only gets an object of its own when the result is
+// a rope
+static Value concatWithNumber(Value string, Value number, bool numberFirst) {
+  StringValue* sString = static_cast<StringValue *>(string.asObject());
+  std::string text = numberToString(number);
+
+  if (sString->length + text.size() < MIN_ROPE_LENGTH) {
+    std::string result = numberFirst ? text + sString->flat() : sString->flat() + text;
+    return Value::object(Heap::get().make<StringValue>(std::move(result)));
+  }
+
+  RootScope roots(Heap::get());
+  roots.root(string);
+  Value sNumber = Value::object(Heap::get().make<StringValue>(std::move(text)));
+  return numberFirst ? concatStrings(sNumber, string) : concatStrings(string, sNumber);
+}
+
+Value calculateBinaryExpression(Value left, Value right, BinaryOperator op) {
+  if (left.isInt() && right.isInt()) {
+    return calculateIntegerBinaryExpression(left.asInt(), right.asInt(), op);
+
+  } else if (left.type() == ValueType::NUMBER_VALUE &&
+      right.type() == ValueType::NUMBER_VALUE) {
+    double result = calculateNumericBinaryExpression(left.asNumber(),
+                                                     right.asNumber(), op);
+
+    return Value::number(result);
+
+  } else if (left.type() == ValueType::BOOLEAN_VALUE &&
+             right.type() == ValueType::BOOLEAN_VALUE) {
+    bool bLeft = left.asBool();
+    bool bRight = right.asBool();
+
+    return Value::integer(bLeft + bRight);
+
+  } else if (left.type() == ValueType::BOOLEAN_VALUE &&
+             right.type() == ValueType::NUMBER_VALUE) {
+    bool bLeft = left.asBool();
+
+    if (right.isInt()) {
+      return Value::integerOrNumber(bLeft + int64_t(right.asInt()));
+    }
+    return Value::number(bLeft + right.asNumber());
+
+  } else if (left.type() == ValueType::NUMBER_VALUE &&
+             right.type() == ValueType::BOOLEAN_VALUE) {
+    bool bRight = right.asBool();
+
+    if (left.isInt()) {
+      return Value::integerOrNumber(int64_t(left.asInt()) + bRight);
+    }
+    return Value::number(left.asNumber() + bRight);
+
+  } else if (left.type() == ValueType::STRING_VALUE &&
+             right.type() == ValueType::STRING_VALUE) {
+    return concatStrings(left, right);
+
+  } else if (left.type() == ValueType::STRING_VALUE && right.type() == ValueType::NUMBER_VALUE) {
+    return concatWithNumber(left, right, false);
+
+  } else if (left.type() == ValueType::NUMBER_VALUE && right.type() == ValueType::STRING_VALUE) {
+    return concatWithNumber(right, left, true);
+    
+  } else if (left.type() == ValueType::NULL_VALUE) {
+    return right;
+
+  } else if (right.type() == NULL_VALUE) {
+    return left;
+  }
+
+  Log::err("Binary expression not supported for types");
+  return Value::null();
+}
+
+// Ordered comparison used for every number / bool operand pair
+static bool compareOrdered(double lhs, double rhs, ComparisonOperator op) {
+  switch (op) {
+  case OP_LT:
+    return lhs < rhs;
+  case OP_LE:
+    return lhs <= rhs;
+  case OP_GT:
+    return lhs > rhs;
+  case OP_GE:
+    return lhs >= rhs;
+  case OP_EQ:
+    break;
+  }
+
+  Log::err("Unrecognized operator ", operatorSymbol(op));
+  return false; // unrecheable
+}
+
+bool calculateComparison(Value lhs, Value rhs, ComparisonOperator op) {
+  if (lhs.isInt() && rhs.isInt()) {
+    int32_t a = lhs.asInt();
+    int32_t b = rhs.asInt();
+
+    switch (op) {
+    case OP_EQ:
+      return a == b;
+    case OP_LT:
+      return a < b;
+    case OP_LE:
+      return a <= b;
+    case OP_GT:
+      return a > b;
+    case OP_GE:
+      return a >= b;
+    }
+  }
+
+  bool result = false;
+
+  if (op == OP_EQ) {
+    if (lhs.type() == ValueType::NUMBER_VALUE) {
+      double lhsV = lhs.asNumber();
+
+      if (rhs.type() == ValueType::NUMBER_VALUE) {
+        // NUMBER NUMBER
+        result = lhsV == rhs.asNumber();
+      } else if (rhs.type() == ValueType::BOOLEAN_VALUE) {
+        // NUMBER BOOL
+        bool rhsV = rhs.asBool();
+        result = (lhsV == 1 && rhsV) || (lhsV == 0 && !rhsV);
+      }
+    } else if (lhs.type() == ValueType::NULL_VALUE) {
+      result = rhs.type() == ValueType::NULL_VALUE;
+    } else if (lhs.type() == ValueType::STRING_VALUE) {
+      if (rhs.type() == ValueType::STRING_VALUE) {
+        result = static_cast<StringValue *>(lhs.asObject())->equals(
+                 static_cast<StringValue *>(rhs.asObject()));
+      }
+    } else if (lhs.type() == ValueType::BOOLEAN_VALUE) {
+      bool lhsV = lhs.asBool();
+
+      if (rhs.type() == ValueType::NUMBER_VALUE) {
+        // BOOL NUMBER
+        result = lhsV == rhs.asNumber();
+      } else if (rhs.type() == ValueType::BOOLEAN_VALUE) {
+        // BOOL BOOL
+        result = lhsV == rhs.asBool();
+      }
+    } else {
+      Log::err("Unrecognized type ", lhs.type(), " in comparion");
+    }
+  } else { // only support number x bool
+    double lhsV;
+    double rhsV;
+
+    if (lhs.type() == ValueType::NUMBER_VALUE) {
+      lhsV = lhs.asNumber();
+    } else if (lhs.type() == ValueType::BOOLEAN_VALUE) {
+      lhsV = lhs.asBool();
+    } else {
+      Log::err("Unrecognized type ", lhs.type(), " in comparion");
+    }
+
+    if (rhs.type() == ValueType::NUMBER_VALUE) {
+      rhsV = rhs.asNumber();
+    } else if (rhs.type() == ValueType::BOOLEAN_VALUE) {
+      rhsV = rhs.asBool();
+    } else {
+      return false;
+    }
+
+    result = compareOrdered(lhsV, rhsV, op);
+  }
+
+  return result;
+}
+
+bool conditionTypeError(Value value) {
+  Log::err("Cannot handle type ", value.type(), " in condition");
+  return false;
+}
+
+bool logicalTypeError(Value value) {
+  Log::err("Unsupported type ", value.type(), " in logical operation");
+  return false;
+}
@@ -0,0 +1,322 @@
+#include "../include/optimizer.hpp"
+#include "../include/operations.hpp"
+#include "../include/heap.hpp"
+#include "../include/log.hpp"
+#include <cstring>
+
+void Optimizer::optimize(Program& program) {
+  arena = program.arena.get();
+  scopes.clear();
+  globalConstants.clear();
+  scratch.clear();
+
+  program.body = optimizeBody(program.body, true);
+};
+
+// HELPER FUNCTIONS
+
+// Whether a statement of the body stops it early, leaving the functions
+// declared in it aside
+static bool hasEscape(NodeList<Statement*>& body) {
+  for (auto stmt : body) {
+    switch (stmt->type) {
+      case NodeType::BREAK_STATEMENT:
+      case NodeType::CONTINUE_STATEMENT:
+      case NodeType::RETURN_STATEMENT:
+        return true;
+
+      case NodeType::IF_STATEMENT: {
+        auto ifStmt = nodeCast<IfStatement>(stmt);
+        if (hasEscape(ifStmt->ifBody) || hasEscape(ifStmt->elseBody)) {
+          return true;
+        }
+        break;
+      }
+
+      case NodeType::WHILE_STATEMENT:
+        if (hasEscape(nodeCast<WhileStatement>(stmt)->body)) {
+          return true;
+        }
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  return false;
+};
+
+NodeList<Statement*> Optimizer::optimizeBody(NodeList<Statement*> body, bool topLevel) {
+  size_t from = scratch.size();
+  for (auto stmt : body) {
+    optimizeStatement(stmt, topLevel);
+  }
+
+  return arena->takeList(scratch, from);
+};
+
+// Pushes the statement, or what replaces it, on the scratch list
+void Optimizer::optimizeStatement(Statement* stmt, bool topLevel) {
+  switch (stmt->type) {
+    case NodeType::VAR_DECLARATION: {
+      auto decl = nodeCast<VarDeclaration>(stmt);
+      decl->value = optimizeExpression(decl->value);
+
+      Value value;
+      if (decl->isConstant && topLevel && literalValue(decl->value, value)) {
+        Constants& constants = scopes.empty() ? globalConstants : scopes.back();
+        constants.emplace(decl->slot, decl->value);
+      }
+      break;
+    }
+
+    case NodeType::VAR_ASSIGNMENT: {
+      auto assign = nodeCast<VariableAssignment>(stmt);
+      assign->expr = optimizeExpression(assign->expr);
+      break;
+    }
+
+    case NodeType::FUNC_DECLARATION: {
+      auto decl = nodeCast<FunctionDeclaration>(stmt);
+      scopes.emplace_back();
+      decl->body = optimizeBody(decl->body, true);
+      scopes.pop_back();
+      break;
+    }
+
+    case NodeType::RETURN_STATEMENT: {
+      auto ret = nodeCast<ReturnStatement>(stmt);
+      if (ret->value) {
+        ret->value = optimizeExpression(ret->value);
+      }
+      break;
+    }
+
+    case NodeType::IF_STATEMENT:
+      pruneIf(nodeCast<IfStatement>(stmt));
+      return;
+
+    case NodeType::WHILE_STATEMENT: {
+      auto whileStmt = nodeCast<WhileStatement>(stmt);
+      whileStmt->cond = optimizeExpression(whileStmt->cond);
+
+      // Strings are left for the runtime error
+      Value cond;
+      if (literalValue(whileStmt->cond, cond) && !cond.isObject() && !isTruthy(cond, true)) {
+        return;
+      }
+
+      whileStmt->body = optimizeBody(whileStmt->body, false);
+      break;
+    }
+
+    case NodeType::BREAK_STATEMENT:
+    case NodeType::CONTINUE_STATEMENT:
+      break;
+
+    case NodeType::PROGRAM:
+      Log::err("Nested program node");
+      break;
+
+    default:
+      stmt = optimizeExpression(static_cast<Expression*>(stmt));
+      break;
+  }
+
+  scratch.push_back(stmt);
+};
+
+void Optimizer::pruneIf(IfStatement* ifStmt) {
+  ifStmt->cond = optimizeExpression(ifStmt->cond);
+
+  Value cond;
+  if (!literalValue(ifStmt->cond, cond) || cond.isObject()) {
+    ifStmt->ifBody = optimizeBody(ifStmt->ifBody, false);
+    ifStmt->elseBody = optimizeBody(ifStmt->elseBody, false);
+    scratch.push_back(ifStmt);
+    return;
+  }
+
+  auto taken = optimizeBody(isTruthy(cond, true) ? ifStmt->ifBody : ifStmt->elseBody, false);
+
+  if (!hasEscape(taken)) {
+    for (auto stmt : taken) {
+      scratch.push_back(stmt);
+    }
+    return;
+  }
+
+  ifStmt->cond = arena->make<BooleanLiteral>("true");
+  ifStmt->ifBody = taken;
+  ifStmt->elseBody = NodeList<Statement*>();
+  scratch.push_back(ifStmt);
+};
+
+Expression* Optimizer::optimizeExpression(Expression* expr) {
+  switch (expr->type) {
+    case NodeType::IDENTIFIER_LITERAL: {
+      auto ident = nodeCast<Identifier>(expr);
+      int depth = ident->depth;
+
+      Constants* constants = nullptr;
+      if (depth == static_cast<int>(scopes.size())) {
+        constants = &globalConstants;
+      } else if (depth >= 0 && depth < static_cast<int>(scopes.size())) {
+        constants = &scopes[scopes.size() - 1 - depth];
+      }
+
+      if (constants) {
+        auto it = constants->find(ident->slot);
+        if (it != constants->end()) {
+          return it->second;
+        }
+      }
+      return expr;
+    }
+
+    case NodeType::BINARY_EXPRESSION: {
+      auto bin = nodeCast<BinaryExpression>(expr);
+      bin->left = optimizeExpression(bin->left);
+      bin->right = optimizeExpression(bin->right);
+      return foldBinary(bin);
+    }
+
+    case NodeType::COMPARISON_EXPRESSION: {
+      auto comp = nodeCast<ComparisonExpression>(expr);
+      comp->lhs = optimizeExpression(comp->lhs);
+      comp->rhs = optimizeExpression(comp->rhs);
+      return foldComparison(comp);
+    }
+
+    case NodeType::LOGICAL_EXPRESSION: {
+      auto logic = nodeCast<LogicalExpression>(expr);
+      logic->lhs = optimizeExpression(logic->lhs);
+      logic->rhs = optimizeExpression(logic->rhs);
+      return foldLogical(logic);
+    }
+
+    case NodeType::CALL_EXPRESSION: {
+      // The callee stays an identifier, the engines call through names
+      auto call = nodeCast<CallExpression>(expr);
+      for (auto& arg : call->arguments) {
+        arg = optimizeExpression(arg);
+      }
+      return expr;
+    }
+
+    default:
+      return expr; // literals
+  }
+};
+
+Expression* Optimizer::foldBinary(BinaryExpression* bin) {
+  Value left;
+  Value right;
+  if (!literalValue(bin->left, left) || !literalValue(bin->right, right)) {
+    return bin;
+  }
+
+  // Cases that raise an error at runtime
+  if ((bin->op == OP_DIV || bin->op == OP_MOD) && right.isNumber()) {
+    double divisor = right.asNumber();
+    if (bin->op == OP_DIV ? divisor == 0 : static_cast<int64_t>(divisor) == 0) {
+      return bin;
+    }
+  }
+  if ((left.isObject() && right.isBool()) || (left.isBool() && right.isObject())) {
+    return bin;
+  }
+
+  return makeLiteral(calculateBinaryExpression(left, right, bin->op));
+};
+
+Expression* Optimizer::foldComparison(ComparisonExpression* comp) {
+  Value lhs;
+  Value rhs;
+  if (!literalValue(comp->lhs, lhs) || !literalValue(comp->rhs, rhs)) {
+    return comp;
+  }
+
+  // Ordered comparisons reject anything but numbers and bools on the left
+  if (comp->op != OP_EQ && !lhs.isNumber() && !lhs.isBool()) {
+    return comp;
+  }
+
+  return makeLiteral(Value::boolean(calculateComparison(lhs, rhs, comp->op)));
+};
+
+// A literal operand that decides the result removes the other one. Operands
+// other than numbers and bools are left for the runtime error
+Expression* Optimizer::foldLogical(LogicalExpression* logic) {
+  Value lhs;
+  if (!literalValue(logic->lhs, lhs) || !(lhs.isNumber() || lhs.isBool())) {
+    return logic;
+  }
+
+  bool lhsTrue = isLogicallyTrue(lhs);
+  if (logic->op == OP_AND ? !lhsTrue : lhsTrue) {
+    return makeLiteral(Value::boolean(lhsTrue));
+  }
+
+  Value rhs;
+  if (literalValue(logic->rhs, rhs) && (rhs.isNumber() || rhs.isBool())) {
+    return makeLiteral(Value::boolean(isLogicallyTrue(rhs)));
+  }
+
+  // These already result in a bool, the right side can stand on its own
+  if (logic->rhs->type == NodeType::COMPARISON_EXPRESSION ||
+      logic->rhs->type == NodeType::LOGICAL_EXPRESSION) {
+    return logic->rhs;
+  }
+  return logic;
+};
+
+// String literals become their interned runtime string
+bool Optimizer::literalValue(Expression* expr, Value& value) {
+  switch (expr->type) {
+    case NodeType::NUMERIC_LITERAL: {
+      auto num = nodeCast<NumericLiteral>(expr);
+      value = num->integer ? Value::integer(static_cast<int32_t>(num->number)) : Value::number(num->number);
+      return true;
+    }
+
+    case NodeType::STRING_LITERAL:
+      value = Value::object(Heap::get().intern(nodeCast<StringLiteral>(expr)->value));
+      return true;
+
+    case NodeType::BOOLEAN_LITERAL:
+      value = Value::boolean(nodeCast<BooleanLiteral>(expr)->value == "true");
+      return true;
+
+    case NodeType::NULL_LITERAL:
+      value = Value::null();
+      return true;
+
+    default:
+      return false;
+  }
+};
+
+Expression* Optimizer::makeLiteral(Value value) {
+  if (value.isNumber()) {
+    // Literals keep the sign apart from the text, as the parser makes them
+    std::string text = numberToString(value);
+    bool negative = text.starts_with('-');
+    std::string_view digits = copyText(negative ? text.substr(1) : text);
+    return arena->make<NumericLiteral>(digits, negative, value.asNumber(), value.isInt());
+  } else if (value.isBool()) {
+    return arena->make<BooleanLiteral>(value.asBool() ? "true" : "false");
+  } else if (value.isNull()) {
+    return arena->make<NullLiteral>();
+  }
+
+  auto string = static_cast<StringValue*>(value.asObject());
+  return arena->make<StringLiteral>(copyText(string->flat()));
+};
+
+std::string_view Optimizer::copyText(std::string_view text) {
+  char* chars = static_cast<char*>(arena->allocate(text.size(), 1));
+  std::memcpy(chars, text.data(), text.size());
+  return std::string_view(chars, text.size());
+};
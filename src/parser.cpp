@@ -4,56 +4,47 @@
 #include "../include/node.hpp"
 #include <memory>
 #include <string>
+#include <charconv>
 
 // CONSTRUCTOR 
 Parser::Parser() {};
 
 // HELPER FUNCTIONS
-Token Parser::peak() {
-  return tokens.front();
+const Token& Parser::peak() {
+  return tokens.peak();
 };
 
-Token Parser::peak(int n) {
-  if (n >= tokens.size()) {
-    Log::err("Token at index ", n, " is out of bounds");
-  }
-
-  return tokens.at(n);
+const Token& Parser::peak(int n) {
+  return tokens.peak(n);
 };
 
-Token Parser::eat() {
+const Token& Parser::eat() {
   changedLine = isNextTokenOnSameLine() ? false : true;
   
-  Token token = this->tokens.front();
-  this->tokens.erase(this->tokens.begin());
-  return token;
+  return tokens.advance();
 };
 
-Token Parser::expect(TokenType tokenType, const char* errorMessage) {
-  if (this->tokens.front().type != tokenType) {
+const Token& Parser::expect(TokenType tokenType, const char* errorMessage) {
+  if (tokens.peak().type != tokenType) {
     Log::err(errorMessage);
   }
 
   changedLine = isNextTokenOnSameLine() ? false : true;
 
   // eat and retur token
-  Token token = this->tokens.front();
-  this->tokens.erase(this->tokens.begin());
-  return token;
+  return tokens.advance();
 };
 
-Token Parser::expect(TokenType tokenType, std::string& errorMessage) {
+const Token& Parser::expect(TokenType tokenType, std::string& errorMessage) {
   
-  if (this->tokens.front().type != tokenType) {
+  if (tokens.peak().type != tokenType) {
     Log::err(errorMessage);
   }
 
   changedLine = isNextTokenOnSameLine() ? false : true;
 
   // eat and retur token
-  Token token = this->tokens.front();
-  this->tokens.erase(this->tokens.begin());
-  return token;
+  return tokens.advance();
 };
 
 void Parser::expectOptionalSemicolon(std::string& message) {
@@ -87,31 +78,28 @@ void Parser::expectOptionalSemicolon(const char * message) {
 };
 
 bool Parser::isNextTokenOnSameLine() {
-  if (tokens.size() < 2) return false; // case where there is only "END_OF_FILE" token
+  if (peak().type == TokenType::END_OF_FILE) return false; // case where there is only "END_OF_FILE" token
   
-  return tokens[0].line == tokens[1].line; 
+  return peak(0).line == peak(1).line; 
 }
 
 // MAIN FUNCTION
 Program Parser::parse(std::string& filepath) {
-  Lexer lexer = Lexer();
-  this->tokens = lexer.tokenize(filepath);
-
-  // DEBUG
-  // Log::log("TOKENS");
-  // for (auto token : tokens) {
-  //   Log::log("{", token.type, " ,", token.value, " ,", token.line, "}");
-  // }
-  // END DEBUG
-
-  std::vector<Statement*> body;
+  // Tokens are pulled from the lexer as the parser consumes them
+  this->tokens.open(filepath);
 
   // Create program
-  Program program = Program(body);
+  Program program = Program();
+  program.source = tokens.source();
+  program.arena = std::make_unique<Arena>();
+  this->arena = program.arena.get();
 
+  size_t start = statementScratch.size();
   while(peak().type != TokenType::END_OF_FILE) {
-    program.body.push_back(parseStatement());
+    statementScratch.push_back(parseStatement());
   }
+
+  program.body = arena->takeList(statementScratch, start);
   
   return program;
 };
@@ -124,7 +112,8 @@ Expression* Parser::parsePrimary() {
   switch (peak().type) {
     
     case TokenType::NUMBER:
-      expr = new NumericLiteral(eat().value);
+    case TokenType::INTEGER:
+      expr = makeNumericLiteral(eat(), false);
       break;
 
     case TokenType::BINARY_OP: // Parses unary operations (-, +)
@@ -135,35 +124,35 @@ Expression* Parser::parsePrimary() {
 
       if (peak().value == "-") {
         eat();
-        if (peak().type != TokenType::NUMBER) {
+        if (peak().type != TokenType::NUMBER && peak().type != TokenType::INTEGER) {
           Log::err("Expected a number after unary operator");
         }
-        expr = new NumericLiteral("-" + eat().value);
+        expr = makeNumericLiteral(eat(), true);
         break;
       }
 
       eat();
-      if (peak().type != TokenType::NUMBER) {
+      if (peak().type != TokenType::NUMBER && peak().type != TokenType::INTEGER) {
         Log::err("Expected a number after unary operator");
       }
-      expr = new NumericLiteral(eat().value);
+      expr = makeNumericLiteral(eat(), false);
       break;
 
     case TokenType::IDENTIFIER:
-      expr = new Identifier(eat().value);
+      expr = arena->make<Identifier>(eat().value);
       break;
 
     case TokenType::STRING:
-      expr = new StringLiteral(eat().value);
+      expr = arena->make<StringLiteral>(eat().value);
       break;
 
     case TokenType::BOOLEAN_TOKEN:
-      expr = new BooleanLiteral(eat().value);
+      expr = arena->make<BooleanLiteral>(eat().value);
       break;
 
     case TokenType::NULL_TOKEN:
       eat(); // consume null
-      expr = new NullLiteral();
+      expr = arena->make<NullLiteral>();
       break;
 
     case TokenType::OPEN_PARENT:
@@ -184,6 +173,35 @@ Expression* Parser::parsePrimary() {
   return expr;
 }
 
+// Numbers are converted once here, the interpreter only boxes them. Integer
+// literals too big for an int32 become doubles
+Expression* Parser::makeNumericLiteral(Token token, bool negative) {
+  std::string_view text = token.value;
+
+  if (token.type == TokenType::INTEGER) {
+    int64_t integer = 0;
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), integer);
+    if (error == std::errc() && end == text.data() + text.size()) {
+      integer = negative ? -integer : integer;
+      if (integer >= INT32_MIN && integer <= INT32_MAX) {
+        return arena->make<NumericLiteral>(text, negative, static_cast<double>(integer), true);
+      }
+    }
+  }
+
+  double number = 0;
+  auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), number);
+  if (error != std::errc() || end != text.data() + text.size()) {
+    Log::err("Invalid numeric literal '", text, "'");
+  }
+
+  if (negative) {
+    number = -number;
+  }
+
+  return arena->make<NumericLiteral>(text, negative, number, false);
+}
+
 /* Orders Of Prescidence */
 // PrimaryExpr / Call
 // MultiplicitaveExpr
@@ -197,9 +215,10 @@ Expression* Parser::parseMultiplicativeExpression() {
   Expression* left = parsePrimary();
 
   while (peak().type == TokenType::BINARY_OP && (peak().value == "*" || peak().value == "/" || peak().value == "%")) {
-    std::string op = eat().value;
+    std::string_view symbol = eat().value;
+    BinaryOperator op = symbol == "*" ? OP_MUL : symbol == "/" ? OP_DIV : OP_MOD;
     Expression* right = parsePrimary(); // The right operand is another primary expression
-    left = new BinaryExpression(op, left, right);
+    left = arena->make<BinaryExpression>(op, left, right);
   }
   return left;
 }
@@ -209,9 +228,9 @@ Expression* Parser::parseAdditiveExpression() {
   Expression* left = parseMultiplicativeExpression();
 
   while (peak().type == TokenType::BINARY_OP && (peak().value == "+" || peak().value == "-")) {
-    std::string op = eat().value; // Consume the operator
+    BinaryOperator op = eat().value == "+" ? OP_ADD : OP_SUB; // Consume the operator
     Expression* right = parseMultiplicativeExpression();
-    left = new BinaryExpression(op, left, right);
+    left = arena->make<BinaryExpression>(op, left, right);
   }
   return left;
 }
@@ -221,9 +240,14 @@ Expression* Parser::parseComparisonExpression() {
   Expression* left = parseAdditiveExpression();
 
   while (peak().type == TokenType::COMPARISON) {
-    std::string op = eat().value; // Consume the comparison operator
+    std::string_view symbol = eat().value; // Consume the comparison operator
+    ComparisonOperator op = OP_EQ;
+    if (symbol == "<") op = OP_LT;
+    else if (symbol == "<=") op = OP_LE;
+    else if (symbol == ">") op = OP_GT;
+    else if (symbol == ">=") op = OP_GE;
     Expression* right = parseAdditiveExpression();
-    left = new ComparisonExpression(left, right, op);
+    left = arena->make<ComparisonExpression>(left, right, op);
   }
   return left;
 }
@@ -232,9 +256,9 @@ Expression* Parser::parseAndExpression() {
   Expression* left = parseComparisonExpression();
 
   while (peak().type == TokenType::AND) {
-    std::string op = eat().value;
+    eat();
     Expression* right = parseComparisonExpression();
-    left = new LogicalExpression(left, right, op);
+    left = arena->make<LogicalExpression>(left, right, OP_AND);
   }
 
   return left;
@@ -244,9 +268,9 @@ Expression* Parser::parseOrExpression() {
   Expression* left = parseAndExpression();
 
   while (peak().type == TokenType::OR) {
-    std::string op = eat().value;
+    eat();
     Expression* right = parseAndExpression();
-    left = new LogicalExpression(left, right, op);
+    left = arena->make<LogicalExpression>(left, right, OP_OR);
   }
 
   return left;
@@ -259,20 +283,20 @@ Expression* Parser::parseExpression() {
 Expression* Parser::parseCallExpression(Expression* caller) {
   eat(); // Eat Open Parent '(' Token
 
-  std::vector<Expression*> args;
+  size_t start = expressionScratch.size();
 
   if (peak().type != TokenType::CLOSE_PARENT) {
-    args.push_back(parseExpression());
+    expressionScratch.push_back(parseExpression());
 
     while (peak().type == TokenType::COMMA) {
       eat(); // consume comma
-      args.push_back(parseExpression());
+      expressionScratch.push_back(parseExpression());
     }
   }
 
   expect(TokenType::CLOSE_PARENT, "Expected ')' after function arguments");
 
-  return new CallExpression(caller, args);
+  return arena->make<CallExpression>(caller, arena->takeList(expressionScratch, start));
 }
 
 // STATEMENTS - do not result in values - varDeclarations
@@ -307,16 +331,27 @@ Statement* Parser::parseStatement() {
   return stmt;
 };
 
+// Parses statements up to (not including) the closing brace of a block
+NodeList<Statement*> Parser::parseBlock() {
+  size_t start = statementScratch.size();
+
+  while(peak().type != TokenType::END_OF_FILE && peak().type != TokenType::CLOSE_BRACE) {
+    statementScratch.push_back(parseStatement());
+  }
+
+  return arena->takeList(statementScratch, start);
+}
+
 Statement* Parser::parseBreakStatement() {
   eat();
 
-  return new BreakStatement();
+  return arena->make<BreakStatement>();
 }
 
 Statement* Parser::parseContinueStatement() {
   eat();
 
-  return new ContinueStatement();
+  return arena->make<ContinueStatement>();
 }
 
 Statement* Parser::parseWhileStatement() {
@@ -336,14 +371,11 @@ Statement* Parser::parseWhileStatement() {
 
   expect(TokenType::OPEN_BRACE, "while statement body must start with open brace '{'");
 
-  std::vector<Statement*> body;
-  while(peak().type != TokenType::END_OF_FILE && peak().type != TokenType::CLOSE_BRACE) {
-    body.push_back(parseStatement());
-  }
+  NodeList<Statement*> body = parseBlock();
 
   expect(TokenType::CLOSE_BRACE, "'while' statement body must end with close braces '}'");
 
-  return new WhileStatement(cond, body);
+  return arena->make<WhileStatement>(cond, body);
 };
 
 Statement* Parser::parseIfStatement() {
@@ -363,54 +395,48 @@ Statement* Parser::parseIfStatement() {
 
   expect(TokenType::OPEN_BRACE, "if statement body must start with open brace '{'");
 
-  std::vector<Statement*> ifBody;
-  while(peak().type != TokenType::END_OF_FILE && peak().type != TokenType::CLOSE_BRACE) {
-    ifBody.push_back(parseStatement());
-  }
+  NodeList<Statement*> ifBody = parseBlock();
 
   expect(TokenType::CLOSE_BRACE, "'if' statement body must end with close braces '}'");
 
-  std::vector<Statement*> elseBody; 
+  NodeList<Statement*> elseBody; 
   if (peak().type == TokenType::ELSE) {
     eat();
     expect(TokenType::OPEN_BRACE, "Expected open brace '{' after 'else' keyword");
 
-    while(peak().type != TokenType::END_OF_FILE && peak().type != TokenType::CLOSE_BRACE) {
-      elseBody.push_back(parseStatement());
-    }
+    elseBody = parseBlock();
 
     expect(TokenType::CLOSE_BRACE, "Expected close crace '}' when ending 'else' statement body");
   }
 
-  return new IfStatement(cond, ifBody, elseBody);
+  return arena->make<IfStatement>(cond, ifBody, elseBody);
 };
 
 Statement* Parser::parseReturnStatement() {
-  auto returnTk = eat();
+  int returnLine = eat().line;
 
-  if (peak().type == TokenType::SEMICOLON || peak().line != returnTk.line ) {
-    return new ReturnStatement(new NullLiteral());
+  if (peak().type == TokenType::SEMICOLON || peak().line != returnLine ) {
+    return arena->make<ReturnStatement>(arena->make<NullLiteral>());
   }
 
   Expression* expr = parseExpression();
-  return new ReturnStatement(expr);
+  return arena->make<ReturnStatement>(expr);
 };
 
 Statement* Parser::parseVarDeclaration() {
-  Token token = eat();
-  bool isConstant = token.type == TokenType::CONST;
+  bool isConstant = eat().type == TokenType::CONST;
 
   Token ident = expect(TokenType::IDENTIFIER, "Expected Identifier symbol");
   
   if (peak().type != TokenType::EQUAL) {
-    return new VarDeclaration(ident.value, new NullLiteral(), isConstant);
+    return arena->make<VarDeclaration>(ident.value, arena->make<NullLiteral>(), isConstant);
   }
   
   expect(TokenType::EQUAL, "Expexted equals character '='");
 
   Expression* value = parseExpression();
 
-  return new VarDeclaration(ident.value, value, isConstant);
+  return arena->make<VarDeclaration>(ident.value, value, isConstant);
 };
 
 Statement* Parser::parseFunctionDeclaration() {
@@ -420,35 +446,28 @@ Statement* Parser::parseFunctionDeclaration() {
   expect(TokenType::OPEN_PARENT, "Expected '(' in order to initialize arguments for function declaration");
 
   // Get parameters list
-  std::vector<std::string> params;
+  size_t start = nameScratch.size();
 
   if (peak().type != TokenType::CLOSE_PARENT) {
-    auto param = expect(TokenType::IDENTIFIER, "Expected a parameter in function declaration");
-    params.push_back(param.value);
+    nameScratch.push_back(expect(TokenType::IDENTIFIER, "Expected a parameter in function declaration").value);
 
     while(peak().type == TokenType::COMMA) {
       eat(); // eat comma
-      param = expect(TokenType::IDENTIFIER, "Expected a parameter in function declaration");
-      params.push_back(param.value);
+      nameScratch.push_back(expect(TokenType::IDENTIFIER, "Expected a parameter in function declaration").value);
     }
 
   }
+  NodeList<std::string_view> params = arena->takeList(nameScratch, start);
   expect(TokenType::CLOSE_PARENT, "Expected closing parenthesis ')' in the end of function parameters declaration");
 
   // Get function body
   expect(TokenType::OPEN_BRACE, "Expected open brace for initializing function body");
 
-  std::vector<Statement*> body;
-
-  while(peak().type != TokenType::CLOSE_BRACE) {
-
-    body.push_back(parseStatement());
-
-  }
+  NodeList<Statement*> body = parseBlock();
 
   expect(TokenType::CLOSE_BRACE, "Expected close brace '}' ending function body");
 
-  return new FunctionDeclaration(funcIdent.value, params, body);
+  return arena->make<FunctionDeclaration>(funcIdent.value, params, body);
 }
 
 Statement* Parser::parseVarAssignment() {
@@ -458,14 +477,14 @@ Statement* Parser::parseVarAssignment() {
     Log::err("Expected equal token '=' in variable assignment");  
   }
 
-  auto ident = dynamic_cast<Identifier*>(left);
-  if (!ident) {
+  if (left->type != NodeType::IDENTIFIER_LITERAL) {
     Log::err("Left hand side of assignment expression should be an identifier");
   }
+  auto ident = nodeCast<Identifier>(left);
 
   eat();
 
   auto right = parseExpression();
 
-  return new VariableAssignment(ident->symbol, right);
+  return arena->make<VariableAssignment>(ident->symbol, right);
 };
\ No newline at end of file
@@ -0,0 +1,14 @@
+#include "../include/pool.hpp"
+
+void Pool::refill(size_t sizeClass) {
+  size_t blockSize = (sizeClass + 1) * GRANULARITY;
+  char* slab = static_cast<char*>(::operator new(SLAB_SIZE));
+
+  Block* head = freeLists[sizeClass];
+  for (size_t offset = 0; offset + blockSize <= SLAB_SIZE; offset += blockSize) {
+    Block* block = reinterpret_cast<Block*>(slab + offset);
+    block->next = head;
+    head = block;
+  }
+  freeLists[sizeClass] = head;
+}
@@ -0,0 +1,209 @@
+#include "../include/resolver.hpp"
+#include "../include/log.hpp"
+
+Resolver::Resolver(Enviroment& globals) : globals(globals) {};
+
+void Resolver::resolve(Program& program) {
+  scopes.clear();
+  globalScope = Scope();
+  pendingGlobals.clear();
+
+  resolveBody(program.body);
+  resolvePending();
+};
+
+// HELPER FUNCTIONS
+int Resolver::declare(std::string_view name, bool constant) {
+  Scope& scope = scopes.empty() ? globalScope : scopes.back();
+
+  auto it = scope.bindings.find(name);
+  if (it == scope.bindings.end() && scopes.empty()) {
+    int hostSlot = globals.slotOf(name);
+    if (hostSlot >= 0) {
+      it = scope.bindings.emplace(name, Binding{hostSlot, globals.isConstant(hostSlot)}).first;
+    }
+  }
+
+  if (it != scope.bindings.end()) {
+    if (it->second.constant != constant) {
+      Log::err("Cannot declare variable '", name, "' as it was already declared");
+    }
+    return it->second.slot; // other redeclarations are reported when they run
+  }
+
+  int slot = scopes.empty() ? globals.defineSlot(name) : scope.count++;
+  scope.bindings.emplace(name, Binding{slot, constant});
+  return slot;
+};
+
+Resolver::Binding Resolver::lookup(std::string_view name, int& depth) {
+  for (int i = scopes.size() - 1; i >= 0; i--) {
+    auto it = scopes[i].bindings.find(name);
+    if (it != scopes[i].bindings.end()) {
+      depth = scopes.size() - 1 - i;
+      return it->second;
+    }
+  }
+
+  depth = scopes.size();
+  auto it = globalScope.bindings.find(name);
+  if (it != globalScope.bindings.end()) {
+    return it->second;
+  }
+
+  // Declared by the host, or not at all
+  int slot = globals.slotOf(name);
+  if (slot < 0) {
+    depth = -1;
+  }
+  return Binding{slot, slot >= 0 && globals.isConstant(slot)};
+};
+
+void Resolver::resolveBody(NodeList<Statement*>& body) {
+  for (auto stmt : body) {
+    resolveStatement(stmt);
+  }
+};
+
+// Resolves the functions declared in the innermost scope, now that all of its
+// names are known
+void Resolver::resolvePending() {
+  // Taken out of the scope first, resolving a function pushes onto scopes
+  std::vector<FunctionDeclaration*> pending;
+  pending.swap(scopes.empty() ? pendingGlobals : scopes.back().pending);
+
+  for (auto decl : pending) {
+    resolveFunction(decl);
+  }
+};
+
+void Resolver::resolveFunction(FunctionDeclaration* decl) {
+  scopes.emplace_back();
+
+  // Each parameter gets its own slot, the engines fill one per argument
+  for (auto param : decl->params) {
+    if (scopes.back().bindings.contains(param)) {
+      Log::err("Cannot declare variable '", param, "' as it was already declared");
+    }
+    declare(param, false);
+  }
+
+  resolveBody(decl->body);
+  resolvePending();
+
+  decl->localCount = scopes.back().count;
+  scopes.pop_back();
+};
+
+void Resolver::resolveStatement(Statement* stmt) {
+  switch (stmt->type) {
+    case NodeType::VAR_DECLARATION: {
+      auto decl = nodeCast<VarDeclaration>(stmt);
+      resolveExpression(decl->value);
+      decl->slot = declare(decl->symbol, decl->isConstant);
+      break;
+    }
+
+    case NodeType::VAR_ASSIGNMENT: {
+      auto assign = nodeCast<VariableAssignment>(stmt);
+      resolveExpression(assign->expr);
+      Binding binding = lookup(assign->ident, assign->depth);
+      assign->slot = binding.slot;
+      if (binding.constant) {
+        Log::err("Cannot reassign variable ", assign->ident, " as it is constant");
+      }
+      break;
+    }
+
+    case NodeType::FUNC_DECLARATION: {
+      auto decl = nodeCast<FunctionDeclaration>(stmt);
+      decl->slot = declare(decl->name, false);
+
+      if (scopes.empty()) {
+        pendingGlobals.push_back(decl);
+      } else {
+        scopes.back().pending.push_back(decl);
+      }
+      break;
+    }
+
+    case NodeType::RETURN_STATEMENT: {
+      auto ret = nodeCast<ReturnStatement>(stmt);
+      if (ret->value) {
+        resolveExpression(ret->value);
+      }
+      break;
+    }
+
+    case NodeType::IF_STATEMENT: {
+      auto ifStmt = nodeCast<IfStatement>(stmt);
+      resolveExpression(ifStmt->cond);
+      resolveBody(ifStmt->ifBody);
+      resolveBody(ifStmt->elseBody);
+      break;
+    }
+
+    case NodeType::WHILE_STATEMENT: {
+      auto whileStmt = nodeCast<WhileStatement>(stmt);
+      resolveExpression(whileStmt->cond);
+      resolveBody(whileStmt->body);
+      break;
+    }
+
+    case NodeType::BREAK_STATEMENT:
+    case NodeType::CONTINUE_STATEMENT:
+      break;
+
+    case NodeType::PROGRAM:
+      Log::err("Nested program node");
+      break;
+
+    default:
+      resolveExpression(static_cast<Expression*>(stmt));
+      break;
+  }
+};
+
+void Resolver::resolveExpression(Expression* expr) {
+  switch (expr->type) {
+    case NodeType::IDENTIFIER_LITERAL: {
+      auto ident = nodeCast<Identifier>(expr);
+      ident->slot = lookup(ident->symbol, ident->depth).slot;
+      ident->global = ident->depth >= 0 && ident->depth == static_cast<int>(scopes.size());
+      break;
+    }
+
+    case NodeType::BINARY_EXPRESSION: {
+      auto bin = nodeCast<BinaryExpression>(expr);
+      resolveExpression(bin->left);
+      resolveExpression(bin->right);
+      break;
+    }
+
+    case NodeType::COMPARISON_EXPRESSION: {
+      auto comp = nodeCast<ComparisonExpression>(expr);
+      resolveExpression(comp->lhs);
+      resolveExpression(comp->rhs);
+      break;
+    }
+
+    case NodeType::LOGICAL_EXPRESSION: {
+      auto logic = nodeCast<LogicalExpression>(expr);
+      resolveExpression(logic->lhs);
+      resolveExpression(logic->rhs);
+      break;
+    }
+
+    case NodeType::CALL_EXPRESSION: {
+      auto call = nodeCast<CallExpression>(expr);
+      resolveExpression(call->caller);
+      for (auto arg : call->arguments) {
+        resolveExpression(arg);
+      }
+      break;
+    }
+
+    default:
+      break; // literals
+  }
+};
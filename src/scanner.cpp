@@ -0,0 +1,232 @@
+#include "../include/scanner.hpp"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define ZEPH_SCAN_X86
+#endif
+
+// SCALAR KERNELS
+static inline bool isSpaceByte(unsigned char c) {
+  return c == ' ' || (unsigned char)(c - '\t') <= '\r' - '\t';
+}
+
+static inline bool isDigitByte(unsigned char c) {
+  return (unsigned char)(c - '0') <= 9;
+}
+
+static inline bool isIdentifierByte(unsigned char c) {
+  return (unsigned char)((c | 0x20) - 'a') <= 'z' - 'a' || isDigitByte(c) || c == '_';
+}
+
+static const char* skipSpacesScalar(const char* p, const char* end, int& line) {
+  while (p < end && isSpaceByte(*p)) {
+    if (*p == '\n') line++;
+    p++;
+  }
+  return p;
+}
+
+static const char* skipIdentifierScalar(const char* p, const char* end) {
+  while (p < end && isIdentifierByte(*p)) p++;
+  return p;
+}
+
+static const char* skipDigitsScalar(const char* p, const char* end) {
+  while (p < end && isDigitByte(*p)) p++;
+  return p;
+}
+
+static const char* findNewlineScalar(const char* p, const char* end) {
+  while (p < end && *p != '\n') p++;
+  return p;
+}
+
+static const char* findQuoteScalar(const char* p, const char* end) {
+  while (p < end && *p != '"') p++;
+  return p;
+}
+
+static const ScanKernels scalarKernels = {
+  "scalar",
+  skipSpacesScalar,
+  skipIdentifierScalar,
+  skipDigitsScalar,
+  findNewlineScalar,
+  findQuoteScalar,
+};
+
+#ifdef ZEPH_SCAN_X86
+// SSE2 KERNELS - 16 bytes per step, always available on x86-64
+
+// Bytes where lo <= x <= hi, using an unsigned min since SSE2 has no unsigned compare
+static inline __m128i inRange16(__m128i x, char lo, char hi) {
+  __m128i shifted = _mm_sub_epi8(x, _mm_set1_epi8(lo));
+  return _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(hi - lo)), shifted);
+}
+
+static inline __m128i spaceMask16(__m128i x) {
+  return _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(' ')), inRange16(x, '\t', '\r'));
+}
+
+static inline __m128i digitMask16(__m128i x) {
+  return inRange16(x, '0', '9');
+}
+
+static inline __m128i identifierMask16(__m128i x) {
+  __m128i letters = inRange16(_mm_or_si128(x, _mm_set1_epi8(0x20)), 'a', 'z');
+  __m128i underscore = _mm_cmpeq_epi8(x, _mm_set1_epi8('_'));
+  return _mm_or_si128(_mm_or_si128(letters, underscore), digitMask16(x));
+}
+
+static inline __m128i newlineMask16(__m128i x) {
+  return _mm_cmpeq_epi8(x, _mm_set1_epi8('\n'));
+}
+
+static inline __m128i quoteMask16(__m128i x) {
+  return _mm_cmpeq_epi8(x, _mm_set1_epi8('"'));
+}
+
+template <__m128i (*Match)(__m128i), const char* (*Tail)(const char*, const char*)>
+static const char* skipWhile16(const char* p, const char* end) {
+  while (end - p >= 16) {
+    unsigned mask = _mm_movemask_epi8(Match(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))));
+    if (mask != 0xFFFF) return p + __builtin_ctz(~mask);
+    p += 16;
+  }
+  return Tail(p, end);
+}
+
+template <__m128i (*Match)(__m128i), const char* (*Tail)(const char*, const char*)>
+static const char* findFirst16(const char* p, const char* end) {
+  while (end - p >= 16) {
+    unsigned mask = _mm_movemask_epi8(Match(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))));
+    if (mask != 0) return p + __builtin_ctz(mask);
+    p += 16;
+  }
+  return Tail(p, end);
+}
+
+static const char* skipSpacesSse2(const char* p, const char* end, int& line) {
+  while (end - p >= 16) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    unsigned spaces = _mm_movemask_epi8(spaceMask16(x));
+    unsigned newlines = _mm_movemask_epi8(newlineMask16(x));
+
+    if (spaces != 0xFFFF) {
+      int run = __builtin_ctz(~spaces);
+      line += __builtin_popcount(newlines & ((1u << run) - 1));
+      return p + run;
+    }
+
+    line += __builtin_popcount(newlines);
+    p += 16;
+  }
+  return skipSpacesScalar(p, end, line);
+}
+
+static const ScanKernels sse2Kernels = {
+  "sse2",
+  skipSpacesSse2,
+  skipWhile16<identifierMask16, skipIdentifierScalar>,
+  skipWhile16<digitMask16, skipDigitsScalar>,
+  findFirst16<newlineMask16, findNewlineScalar>,
+  findFirst16<quoteMask16, findQuoteScalar>,
+};
+
+// AVX2 KERNELS - 32 bytes per step, selected at runtime
+#define ZEPH_AVX2 __attribute__((target("avx2")))
+
+ZEPH_AVX2 static inline __m256i inRange32(__m256i x, char lo, char hi) {
+  __m256i shifted = _mm256_sub_epi8(x, _mm256_set1_epi8(lo));
+  return _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8(hi - lo)), shifted);
+}
+
+ZEPH_AVX2 static inline __m256i spaceMask32(__m256i x) {
+  return _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(' ')), inRange32(x, '\t', '\r'));
+}
+
+ZEPH_AVX2 static inline __m256i digitMask32(__m256i x) {
+  return inRange32(x, '0', '9');
+}
+
+ZEPH_AVX2 static inline __m256i identifierMask32(__m256i x) {
+  __m256i letters = inRange32(_mm256_or_si256(x, _mm256_set1_epi8(0x20)), 'a', 'z');
+  __m256i underscore = _mm256_cmpeq_epi8(x, _mm256_set1_epi8('_'));
+  return _mm256_or_si256(_mm256_or_si256(letters, underscore), digitMask32(x));
+}
+
+ZEPH_AVX2 static inline __m256i newlineMask32(__m256i x) {
+  return _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\n'));
+}
+
+ZEPH_AVX2 static inline __m256i quoteMask32(__m256i x) {
+  return _mm256_cmpeq_epi8(x, _mm256_set1_epi8('"'));
+}
+
+template <__m256i (*Match)(__m256i), const char* (*Tail)(const char*, const char*)>
+ZEPH_AVX2 static const char* skipWhile32(const char* p, const char* end) {
+  while (end - p >= 32) {
+    unsigned mask = _mm256_movemask_epi8(Match(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))));
+    if (mask != 0xFFFFFFFFu) return p + __builtin_ctz(~mask);
+    p += 32;
+  }
+  return Tail(p, end);
+}
+
+template <__m256i (*Match)(__m256i), const char* (*Tail)(const char*, const char*)>
+ZEPH_AVX2 static const char* findFirst32(const char* p, const char* end) {
+  while (end - p >= 32) {
+    unsigned mask = _mm256_movemask_epi8(Match(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))));
+    if (mask != 0) return p + __builtin_ctz(mask);
+    p += 32;
+  }
+  return Tail(p, end);
+}
+
+ZEPH_AVX2 static const char* skipSpacesAvx2(const char* p, const char* end, int& line) {
+  while (end - p >= 32) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    unsigned spaces = _mm256_movemask_epi8(spaceMask32(x));
+    unsigned newlines = _mm256_movemask_epi8(newlineMask32(x));
+
+    if (spaces != 0xFFFFFFFFu) {
+      int run = __builtin_ctz(~spaces);
+      line += __builtin_popcount(newlines & ((1u << run) - 1));
+      return p + run;
+    }
+
+    line += __builtin_popcount(newlines);
+    p += 32;
+  }
+  return skipSpacesSse2(p, end, line);
+}
+
+static const ScanKernels avx2Kernels = {
+  "avx2",
+  skipSpacesAvx2,
+  skipWhile32<identifierMask32, skipWhile16<identifierMask16, skipIdentifierScalar>>,
+  skipWhile32<digitMask32, skipWhile16<digitMask16, skipDigitsScalar>>,
+  findFirst32<newlineMask32, findFirst16<newlineMask16, findNewlineScalar>>,
+  findFirst32<quoteMask32, findFirst16<quoteMask16, findQuoteScalar>>,
+};
+#endif
+
+std::vector<const ScanKernels*> supportedScanKernels() {
+  std::vector<const ScanKernels*> kernels = {&scalarKernels};
+#ifdef ZEPH_SCAN_X86
+  kernels.push_back(&sse2Kernels);
+  if (__builtin_cpu_supports("avx2")) {
+    kernels.push_back(&avx2Kernels);
+  }
+#endif
+  return kernels;
+}
+
+const ScanKernels& scanKernels() {
+#ifdef ZEPH_SCAN_X86
+  static const ScanKernels& selected = __builtin_cpu_supports("avx2") ? avx2Kernels : sse2Kernels;
+  return selected;
+#else
+  return scalarKernels;
+#endif
+}
@@ -0,0 +1,51 @@
+#include "../include/source.hpp"
+#include "../include/log.hpp"
+#include <fstream>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+SourceFile::SourceFile(std::string& filepath) : path(filepath) {
+  int fd = ::open(filepath.c_str(), O_RDONLY);
+  if (fd < 0) {
+    Log::err("Error opening file: ", filepath);
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+    void* addr = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr != MAP_FAILED) {
+      madvise(addr, info.st_size, MADV_SEQUENTIAL);
+      data = static_cast<const char*>(addr);
+      size = info.st_size;
+      mapped = true;
+    }
+  }
+  ::close(fd);
+
+  if (!mapped) {
+    // Empty files, pipes and anything else mmap refuses are read into memory
+    std::ifstream file(filepath, std::ios::binary);
+    if (!file) {
+      Log::err("Error opening file: ", filepath);
+    }
+
+    std::stringstream contents;
+    contents << file.rdbuf();
+    buffer = contents.str();
+    data = buffer.data();
+    size = buffer.size();
+  }
+}
+
+SourceFile::~SourceFile() {
+  if (mapped) {
+    munmap(const_cast<char*>(data), size);
+  }
+}
+
+std::string_view SourceFile::text() const {
+  return std::string_view(data, size);
+}
@@ -1,3 +1,5 @@
 #include "../include/token.hpp"
 
-Token::Token(TokenType type, std::string value, int line) : type(type), value(value), line(line) {};
\ No newline at end of file
+Token::Token() : type(TokenType::END_OF_FILE), value(""), line(0) {};
+
+Token::Token(TokenType type, std::string_view value, int line) : type(type), value(value), line(line) {};
\ No newline at end of file
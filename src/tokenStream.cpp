@@ -0,0 +1,35 @@
+#include "../include/tokenStream.hpp"
+#include "../include/log.hpp"
+
+TokenStream::TokenStream() {};
+
+void TokenStream::open(std::string& filepath) {
+  lexer.open(filepath);
+
+  for (int i = 0; i < LOOKAHEAD; i++) {
+    window[i] = lexer.next();
+  }
+  cursor = 0;
+};
+
+const Token& TokenStream::peak(int n) {
+  if (n >= LOOKAHEAD) {
+    Log::err("Token lookahead of ", n, " is out of bounds");
+  }
+
+  return window[(cursor + n) % LOOKAHEAD];
+};
+
+// Consumes the current token and refills its slot. The returned reference
+// stays valid until the next call to advance
+const Token& TokenStream::advance() {
+  previous = std::move(window[cursor]);
+  window[cursor] = lexer.next();
+  cursor = (cursor + 1) % LOOKAHEAD;
+
+  return previous;
+};
+
+std::shared_ptr<SourceFile> TokenStream::source() {
+  return lexer.source;
+};
@@ -0,0 +1,50 @@
+#include "../include/values.hpp"
+#include "../include/heap.hpp"
+
+bool StringValue::equals(StringValue* other) {
+  if (this == other) {
+    return true;
+  }
+
+  // There is one interned string per content
+  if ((interned && other->interned) || length != other->length) {
+    return false;
+  }
+
+  // Only hashes already known are used, computing one costs a comparison
+  if (hashed && other->hashed && hash != other->hash) {
+    return false;
+  }
+
+  return flat() == other->flat();
+}
+
+// Iterative, the left spine of a string built by appending in a loop is as
+// deep as the number of appends
+const std::string& StringValue::flatten() {
+  std::string result;
+  result.reserve(length);
+
+  std::vector<StringValue*> pending = {this};
+  while (!pending.empty()) {
+    StringValue* node = pending.back();
+    pending.pop_back();
+
+    if (node->isRope()) {
+      pending.push_back(node->right);
+      pending.push_back(node->left);
+    } else {
+      result += node->value;
+    }
+  }
+
+  // The halves are no longer referenced from here, the collector frees them
+  // unless something else holds them
+  size_t oldCapacity = value.capacity();
+  value = std::move(result);
+  left = nullptr;
+  right = nullptr;
+  Heap::get().grow(value.capacity() - oldCapacity);
+
+  return value;
+}
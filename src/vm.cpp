@@ -0,0 +1,340 @@
+#include "../include/vm.hpp"
+#include "../include/jit.hpp"
+#include "../include/operations.hpp"
+#include "../include/log.hpp"
+#include <algorithm>
+
+// GCC and Clang jump straight from one handler to the next through a label
+// table, other compilers go through the switch
+#if defined(__GNUC__)
+#define VM_COMPUTED_GOTO
+#endif
+
+VM::VM(Module& module, Enviroment& globals)
+    : module(module), globals(globals), stack(new Value[STACK_SIZE]) {
+  stackTop = stack.get();
+  frames.reserve(MAX_FRAMES);
+
+  rootMarker = Heap::get().addRootMarker([this](Heap& heap) {
+    for (Value* slot = stack.get(); slot < stackTop; slot++) {
+      heap.markValue(*slot);
+    }
+  });
+}
+
+VM::~VM() {
+  Heap::get().removeRootMarker(rootMarker);
+}
+
+Enviroment* VM::enterFrame(FunctionValue* function) {
+  size_t depth = frames.size() - 1; // the top level runs in the globals
+  if (frames.size() >= MAX_FRAMES) {
+    Log::err("Stack overflow in function ", function->name);
+  }
+
+  if (depth >= framePool.size()) {
+    framePool.push_back(std::make_unique<Enviroment>());
+  }
+
+  Enviroment* env = framePool[depth].get();
+  // The arguments are written to the first slots, like in the tree walker
+  int slotCount = std::max<int>(function->params.size(), function->localCount);
+  env->reset(&function->env, slotCount);
+  return env;
+}
+
+Value VM::run() {
+  const Chunk* chunk = module.chunks[0].get();
+  const uint8_t* ip = chunk->code.data();
+  Value* sp = stack.get();
+  Value* stackEnd = stack.get() + STACK_SIZE;
+  Enviroment* env = &globals;
+
+  if (static_cast<size_t>(chunk->maxStack) > STACK_SIZE) {
+    Log::err("Stack overflow");
+  }
+  frames.push_back(CallFrame{chunk, ip, sp, env});
+
+#define READ_U16() (ip += 2, static_cast<uint16_t>(ip[-2] | (ip[-1] << 8)))
+#define PUSH(value) (*sp++ = (value))
+#define POP() (*--sp)
+#define PEEK() (sp[-1])
+
+#ifdef VM_COMPUTED_GOTO
+  static void* dispatchTable[] = {
+#define BYTECODE_LABEL(name, operands, effect) &&op_##name,
+      BYTECODE_OPCODES(BYTECODE_LABEL)
+#undef BYTECODE_LABEL
+  };
+#define DISPATCH() goto *dispatchTable[*ip++]
+#define CASE(name) op_##name:
+  DISPATCH();
+#else
+#define DISPATCH() continue
+#define CASE(name) case OpCode::name:
+  for (;;) {
+    switch (static_cast<OpCode>(*ip++)) {
+#endif
+
+  CASE(CONSTANT) {
+    PUSH(chunk->constants[READ_U16()]);
+    DISPATCH();
+  }
+
+  CASE(PUSH_NULL) {
+    PUSH(Value::null());
+    DISPATCH();
+  }
+
+  CASE(PUSH_TRUE) {
+    PUSH(Value::boolean(true));
+    DISPATCH();
+  }
+
+  CASE(PUSH_FALSE) {
+    PUSH(Value::boolean(false));
+    DISPATCH();
+  }
+
+  CASE(POP) {
+    sp--;
+    DISPATCH();
+  }
+
+  CASE(GET_LOCAL) {
+    uint16_t slot = READ_U16();
+    uint16_t name = READ_U16();
+    Value value = env->slots[slot];
+    if (value.isEmpty()) {
+      Log::err("Variable ", chunk->names[name], " does not exist");
+    }
+    PUSH(value);
+    DISPATCH();
+  }
+
+  CASE(GET_VAR) {
+    uint16_t depth = READ_U16();
+    uint16_t slot = READ_U16();
+    uint16_t name = READ_U16();
+    PUSH(env->lookupVariable(depth, slot, chunk->names[name]));
+    DISPATCH();
+  }
+
+  CASE(SET_LOCAL) {
+    uint16_t slot = READ_U16();
+    uint16_t name = READ_U16();
+    env->assignVariable(0, slot, chunk->names[name], PEEK());
+    DISPATCH();
+  }
+
+  CASE(SET_VAR) {
+    uint16_t depth = READ_U16();
+    uint16_t slot = READ_U16();
+    uint16_t name = READ_U16();
+    env->assignVariable(depth, slot, chunk->names[name], PEEK());
+    DISPATCH();
+  }
+
+  CASE(UNDEFINED_VAR) {
+    Log::err("Variable ", chunk->names[READ_U16()], " does not exist");
+    DISPATCH();
+  }
+
+  CASE(DECLARE_VAR) {
+    uint16_t slot = READ_U16();
+    uint16_t name = READ_U16();
+    env->declareVariable(slot, chunk->names[name], POP());
+    DISPATCH();
+  }
+
+  CASE(MAKE_FUNCTION) {
+    const Chunk* body = module.chunks[READ_U16()].get();
+    FunctionDeclaration* decl = body->decl;
+
+    stackTop = sp;
+    auto func = Heap::get().make<FunctionValue>(decl->name, decl->params, decl->body, nullptr, *env);
+    func->localCount = decl->localCount;
+    func->chunk = body;
+    env->declareVariable(decl->slot, decl->name, Value::object(func));
+    DISPATCH();
+  }
+
+// Numbers are handled inline, everything else goes through the shared
+// operator semantics
+#define BINARY_OP(name, op, integer, numeric)                                  \
+  CASE(name) {                                                                 \
+    Value right = POP();                                                       \
+    Value left = PEEK();                                                       \
+    if (left.isInt() && right.isInt()) {                                       \
+      int64_t a = left.asInt();                                                \
+      int64_t b = right.asInt();                                               \
+      PEEK() = integer;                                                        \
+    } else if (left.isNumber() && right.isNumber()) {                          \
+      double a = left.asNumber();                                              \
+      double b = right.asNumber();                                             \
+      PEEK() = Value::number(numeric);                                         \
+    } else {                                                                   \
+      stackTop = sp + 1; /* right is still in its slot */                      \
+      PEEK() = calculateBinaryExpression(left, right, op);                     \
+    }                                                                          \
+    DISPATCH();                                                                \
+  }
+
+  BINARY_OP(ADD, OP_ADD, Value::integerOrNumber(a + b), a + b)
+  BINARY_OP(SUB, OP_SUB, Value::integerOrNumber(a - b), a - b)
+  BINARY_OP(MUL, OP_MUL, Value::integerOrNumber(a * b), a * b)
+  BINARY_OP(DIV, OP_DIV, calculateIntegerBinaryExpression(a, b, OP_DIV),
+            calculateNumericBinaryExpression(a, b, OP_DIV))
+  BINARY_OP(MOD, OP_MOD, calculateIntegerBinaryExpression(a, b, OP_MOD),
+            calculateNumericBinaryExpression(a, b, OP_MOD))
+#undef BINARY_OP
+
+#define COMPARISON_OP(name, op, cmp)                                           \
+  CASE(name) {                                                                 \
+    Value right = POP();                                                       \
+    Value left = PEEK();                                                       \
+    if (left.isInt() && right.isInt()) {                                       \
+      PEEK() = Value::boolean(left.asInt() cmp right.asInt());                 \
+    } else {                                                                   \
+      PEEK() = Value::boolean(calculateComparison(left, right, op));           \
+    }                                                                          \
+    DISPATCH();                                                                \
+  }
+
+  COMPARISON_OP(EQ, OP_EQ, ==)
+  COMPARISON_OP(LT, OP_LT, <)
+  COMPARISON_OP(LE, OP_LE, <=)
+  COMPARISON_OP(GT, OP_GT, >)
+  COMPARISON_OP(GE, OP_GE, >=)
+#undef COMPARISON_OP
+
+  CASE(AND) {
+    uint16_t offset = READ_U16();
+    if (!isLogicallyTrue(PEEK())) {
+      PEEK() = Value::boolean(false);
+      ip += offset;
+    } else {
+      sp--;
+    }
+    DISPATCH();
+  }
+
+  CASE(OR) {
+    uint16_t offset = READ_U16();
+    if (isLogicallyTrue(PEEK())) {
+      PEEK() = Value::boolean(true);
+      ip += offset;
+    } else {
+      sp--;
+    }
+    DISPATCH();
+  }
+
+  CASE(TEST) {
+    PEEK() = Value::boolean(isLogicallyTrue(PEEK()));
+    DISPATCH();
+  }
+
+  CASE(JUMP) {
+    uint16_t offset = READ_U16();
+    ip += offset;
+    DISPATCH();
+  }
+
+  CASE(JUMP_IF_FALSE) {
+    uint16_t offset = READ_U16();
+    if (!isTruthy(POP(), true)) {
+      ip += offset;
+    }
+    DISPATCH();
+  }
+
+  CASE(LOOP_IF_TRUE) {
+    uint16_t offset = READ_U16();
+    if (isTruthy(POP(), false)) {
+      ip -= offset;
+    }
+    DISPATCH();
+  }
+
+  CASE(CALL) {
+    uint16_t argc = READ_U16();
+    uint16_t name = READ_U16();
+    Value* callee = sp - argc - 1;
+
+    if (callee->type() != ValueType::FUNCTION_VALUE) {
+      Log::err("Attempted to call a non-function: ", chunk->names[name]);
+    }
+    FunctionValue* function = static_cast<FunctionValue*>(callee->asObject());
+
+    if (argc != function->params.size()) {
+      Log::err("Function ", function->name, " expected ", function->params.size(),
+               " arguments, but got ", argc);
+    }
+
+    if (function->extCall != nullptr) {
+      stackTop = sp;
+      Value value = function->extCall(std::span<const Value>(callee + 1, argc));
+      sp = callee;
+      PUSH(value);
+      DISPATCH();
+    }
+
+    Value jitted;
+    if (Jit::get().tryCall(function, std::span<const Value>(callee + 1, argc), jitted)) {
+      sp = callee;
+      PUSH(jitted);
+      DISPATCH();
+    }
+
+    if (function->chunk == nullptr) {
+      Log::err("Function ", function->name, " was not compiled");
+    }
+
+    Enviroment* calleeEnv = enterFrame(function);
+    for (uint16_t i = 0; i < argc; ++i) {
+      calleeEnv->declareVariable(i, function->params[i], callee[i + 1]);
+    }
+
+    if (callee + function->chunk->maxStack > stackEnd) {
+      Log::err("Stack overflow in function ", function->name);
+    }
+
+    frames.back().ip = ip;
+    chunk = function->chunk;
+    ip = chunk->code.data();
+    sp = callee;
+    env = calleeEnv;
+    frames.push_back(CallFrame{chunk, ip, sp, env});
+    DISPATCH();
+  }
+
+  CASE(RETURN) {
+    Value result = POP();
+    sp = frames.back().base;
+    frames.pop_back();
+
+    if (frames.empty()) {
+      return result;
+    }
+
+    CallFrame& caller = frames.back();
+    chunk = caller.chunk;
+    ip = caller.ip;
+    env = caller.env;
+    PUSH(result);
+    DISPATCH();
+  }
+
+#ifndef VM_COMPUTED_GOTO
+    }
+  }
+#endif
+
+#undef CASE
+#undef DISPATCH
+#undef PEEK
+#undef POP
+#undef PUSH
+#undef READ_U16
+}